@@ -124,6 +124,15 @@ struct Tee : Source<Buffer<uint8_t>> {
     Buffer<uint8_t> pop() override {
         return q.pop();
     }
+    /** get up to `max` Buffers of available data */
+    size_t popBatch(Buffer<uint8_t> *out, size_t max) override {
+        if (Tee::empty()) return 0;
+        return q.popBatch(out, max);
+    }
+    /** data becomes available with data in the underlying source */
+    void notify(Signal &s) override {
+        from.notify(s);
+    }
     /** set underlying source and sink */
     Tee(Source<Buffer<uint8_t>> &from, Sink<Buffer<uint8_t>> &to)
         : from(from), to(to) { }
@@ -131,22 +140,243 @@ struct Tee : Source<Buffer<uint8_t>> {
 
 /** convert Sink stream into printable hex
  *
- * useful for debugging low-level stuff
+ * every byte is converted into `\xx`, e.g. `{0xaa, 0x01}` -> `\aa\01`.
+ * Arbitrarily large Buffers are passed on in chunks.
+ * useful for debugging low-level stuff, see Unhexify for the reverse
  */
 struct Hexify : Sink<Buffer<uint8_t>> {
     static constexpr uint8_t map[]="0123456789abcdef";
-    static constexpr size_t blen = 512*3;
+    /** maximum number of input bytes converted into one output Buffer */
+    static constexpr size_t chunk = 512;
+    /** hex conversion stage, for use in static pipes (see pipe.h) */
+    struct Stage {
+        template<typename Next>
+        void operator()(Buffer<uint8_t> &&in, Next &&next) {
+            size_t off = 0;
+            do {
+                size_t n = in.len - off < chunk ? in.len - off : chunk;
+                Buffer<uint8_t> work = 3 * n;
+                encode(in.buf + off, n, work.buf);
+                work.len = 3 * n;
+                next(std::move(work));
+                off += n;
+            } while (off < in.len);
+        }
+        /** lookup table of `\xx` for every byte */
+        struct Table {
+            uint8_t e[256][3];
+        };
+        static constexpr Table mktable() {
+            Table t{};
+            for (int i = 0; i < 256; ++i) {
+                t.e[i][0] = '\\';
+                t.e[i][1] = map[i >> 4];
+                t.e[i][2] = map[i & 0xf];
+            }
+            return t;
+        }
+        static const Table &table() {
+            static constexpr Table t = mktable();
+            return t;
+        }
+        /** write `3 * n` bytes of hex representation of `in` to `out` */
+        static void encode(const uint8_t *in, size_t n, uint8_t *out) {
+            for (size_t i = 0; i < n; ++i) {
+                memcpy(out + 3 * i, table().e[in[i]], 3);
+            }
+        }
+    };
     Sink<Buffer<uint8_t>> &down;
-    Buffer<uint8_t> work = blen;
     bool full() override {
         return down.full();
     }
+    using Sink<Buffer<uint8_t>>::push;
+    /** convert Buffer, chunk by chunk
+     *
+     * the first chunk is guarded by the caller's `full()`, the rest of the
+     * Buffer is dropped once `down` fills up
+     */
     void push(Buffer<uint8_t> &&in) override {
-        for (auto b: in) {
-            work.append({'\\', map[b >> 4], map[b & 0xf]});
+        size_t off = 0;
+        do {
+            if (off && down.full()) {
+#ifdef TOOL_LIBS_STATS
+                dropped();
+#endif
+                return;
+            }
+            size_t n = in.len - off < chunk ? in.len - off : chunk;
+            Buffer<uint8_t> work = 3 * n;
+            Stage::encode(in.buf + off, n, work.buf);
+            work.len = 3 * n;
+            down.push(std::move(work));
+            off += n;
+        } while (off < in.len);
+    }
+    /** convert whole Buffers into as few as possible of printable hex
+     *
+     * Buffers are merged up to `chunk` bytes, larger ones go on their own.
+     * Stops once `down` is full, returns the number of Buffers taken
+     */
+    size_t pushBatch(Buffer<uint8_t> *in, size_t n) override {
+        size_t taken = 0;
+        while (taken < n && !down.full()) {
+            size_t end = taken, sz = 0;
+            do {
+                sz += in[end++].len;
+            } while (end < n && sz + in[end].len <= chunk);
+            Buffer<uint8_t> work = 3 * sz;
+            for (; taken < end; ++taken) {
+                Stage::encode(in[taken].buf, in[taken].len, work.buf + work.len);
+                work.len += 3 * in[taken].len;
+            }
+            down.push(std::move(work));
         }
-        down.push(std::move(work));
-        work = blen;
+        return taken;
     }
     Hexify(Sink<Buffer<uint8_t>> &down) : down(down) {}
 };
+
+/** convert printable hex Source stream back into bytes
+ *
+ * reverse of Hexify, useful for replaying captured hex dumps, e.g. into
+ * Min::In. Every pair of hex digits is converted into a byte, anything else
+ * (`\`, whitespace, newlines) separates them.
+ */
+struct Unhexify : Source<Buffer<uint8_t>> {
+    /** hex parsing stage, for use in static pipes (see pipe.h) */
+    struct Stage {
+        template<typename Next>
+        void operator()(Buffer<uint8_t> &&in, Next &&next) {
+            Buffer<uint8_t> out = (in.len + 1) / 2;
+            auto &t = table();
+            for (auto c: in) {
+                int8_t v = t.v[c];
+                if (v < 0) {
+                    half = -1;
+                } else if (half < 0) {
+                    half = v;
+                } else {
+                    out.buf[out.len++] = half << 4 | v;
+                    half = -1;
+                }
+            }
+            if (out.len) next(std::move(out));
+        }
+        /** lookup table of digit value for every character, -1 if none */
+        struct Table {
+            int8_t v[256];
+        };
+        static constexpr Table mktable() {
+            Table t{};
+            for (int i = 0; i < 256; ++i) {
+                t.v[i] = i >= '0' && i <= '9' ? i - '0'
+                       : i >= 'a' && i <= 'f' ? i - 'a' + 10
+                       : i >= 'A' && i <= 'F' ? i - 'A' + 10
+                       : -1;
+            }
+            return t;
+        }
+        static const Table &table() {
+            static constexpr Table t = mktable();
+            return t;
+        }
+    private:
+        int8_t half{-1}; // pending upper nibble
+    };
+    Source<Buffer<uint8_t>> &from;
+    Queue<Buffer<uint8_t>> q{20};
+    Stage stage;
+    bool empty() override {
+        auto enqueue = [this](Buffer<uint8_t> &&b) {
+            q.trypush(std::move(b));
+        };
+        while (!q.full() && !from.empty()) {
+            stage(from.pop(), enqueue);
+        }
+        return q.empty();
+    }
+    Buffer<uint8_t> pop() override {
+        return q.pop();
+    }
+    void notify(Signal &s) override {
+        from.notify(s);
+    }
+    /** set underlying source of printable hex */
+    Unhexify(Source<Buffer<uint8_t>> &from) : from(from) { }
+};
+
+/** merge small Buffers into fewer, larger transport writes
+ *
+ * Buffers pushed in are appended to a pending Buffer of at most `mtu` bytes,
+ * which is pushed out once the next one does not fit anymore, or once it has
+ * been held back for `hold` ms. Buffers of `mtu` bytes or more are passed
+ * through unchanged, or held back like pending data if flushing the pending
+ * data left no room for them. The hold time is checked by `poll`, which must be
+ * called recurringly:
+ * ```
+ *      Coalesce co{uart, 256, 2};
+ *      Min min{.in=uart, .out=co};
+ *      k.every(1, co, &Coalesce::poll);
+ * ```
+ * with a `hold` of 0 the pending data is flushed on every call of `poll`
+ */
+struct Coalesce : Sink<Buffer<uint8_t>> {
+    Sink<Buffer<uint8_t>> &out;
+    /** maximum size of a single transport write */
+    const size_t mtu;
+    /** maximum time in ms data is held back */
+    const uint32_t hold;
+    Coalesce(Sink<Buffer<uint8_t>> &out, size_t mtu=256, uint32_t hold=1)
+        : out(out), mtu(mtu), hold(hold), pending(mtu) { }
+    bool full() override {
+        return out.full();
+    }
+    using Sink<Buffer<uint8_t>>::push;
+    void push(Buffer<uint8_t> &&b) override {
+        if (pending.len + b.len > mtu && !flush()) {
+            // unguarded push while `out` is full, pending data goes first
+#ifdef TOOL_LIBS_STATS
+            dropped();
+#endif
+            return;
+        }
+        if (b.len >= mtu) {
+            if (!out.full()) {
+                out.push(std::move(b));
+            } else {
+                // no room left after the flush, send it on the next one
+                pending = std::move(b);
+                since = now;
+            }
+            return;
+        }
+        if (!pending.len) since = now;
+        memcpy(pending.buf + pending.len, b.buf, b.len);
+        pending.len += b.len;
+        if (pending.len == mtu) flush();
+    }
+    /** push out pending data
+     *
+     * while `out` is full the data stays pending and is retried by the next
+     * `push` or `poll`. returns false if data is left pending
+     */
+    bool flush() {
+        if (!pending.len) return true;
+        if (out.full()) return false;
+        out.push(std::move(pending));
+        pending = Buffer<uint8_t>(mtu);
+        return true;
+    }
+    /** flush pending data held back for too long
+     *
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void poll(uint32_t time, uint32_t) {
+        now = time;
+        if (pending.len && time - since >= hold) flush();
+    }
+private:
+    Buffer<uint8_t> pending;
+    uint32_t now{}, since{};
+};
@@ -2,15 +2,69 @@
 #include <cstdint>
 #include <core/streams.h>
 namespace CAN {
+#if defined(TOOL_LIBS_CAN_FD)
+/** maximum payload of a CAN FD frame */
+constexpr uint8_t MAXLEN = 64;
+#else
+/** maximum payload of a classic CAN frame, CAN FD needs `TOOL_LIBS_CAN_FD`
+ * (`CAN_FD` cmake option), which grows every Message by 56 bytes */
+constexpr uint8_t MAXLEN = 8;
+#endif
+/** true if Messages have room for CAN FD payloads */
+constexpr bool FD = MAXLEN > 8;
+/** payload length of given data length code */
+constexpr uint8_t lenOf(uint8_t dlc, bool fd=true) {
+    if (dlc <= 8) return dlc;
+    if (!fd) return 8;
+    constexpr uint8_t fdlen[] = {12, 16, 20, 24, 32, 48, 64};
+    return fdlen[(dlc > 15 ? 15 : dlc) - 9];
+}
+/** smallest data length code with room for `len` bytes */
+constexpr uint8_t dlcOf(uint8_t len) {
+    uint8_t dlc = len < 8 ? len : 8;
+    while (lenOf(dlc) < len && dlc < 15) dlc++;
+    return dlc;
+}
 struct Message {
-    uint64_t data;
+    union {
+        /** payload of classic CAN frames */
+        uint64_t data;
+        /** payload of CAN FD frames, `data` are the first 8 bytes */
+        uint8_t bytes[MAXLEN];
+    };
     uint32_t id;
     struct {
         uint8_t rtr:1;
         uint8_t ide:1;
         uint8_t dlc:4;
+        /** CAN FD frame, `dlc` codes up to 64 bytes */
+        uint8_t fdf:1;
+        /** CAN FD bit rate switch */
+        uint8_t brs:1;
     } opts;
+    /** receive time stamp [ns], 0 if not provided by the backend */
+    uint64_t stamp{};
+    /** payload length [bytes] */
+    uint8_t len() const {
+        return lenOf(opts.dlc, FD && opts.fdf);
+    }
+};
+
+/** acceptance filter
+ *
+ * a Message matches if `(msg.id & mask) == (id & mask)` and its `ide` agrees
+ */
+struct Filter {
+    uint32_t id;
+    uint32_t mask;
+    bool ide;
 };
 
-struct CAN : public Sink<Message>, public Source<Message> { };
+struct CAN : public Sink<Message>, public Source<Message> {
+    /** receive only Messages matching one of `n` filters, all if `n == 0`
+     *
+     * backends without filter support receive all Messages
+     */
+    virtual void filter(const Filter *, size_t) { }
+};
 }
@@ -1,6 +1,5 @@
 #pragma once
 #include "can.h"
-#include <utils/deadline.h>
 #include <core/kern.h>
 
 
@@ -33,23 +32,78 @@ struct SDO {
     uint8_t cmd;    ///< type of request
     uint8_t nodeID; ///< node ID of device
 
+    /** all 8 bytes as sent on the bus */
+    uint64_t raw() const {
+        return cmd | (uint64_t)ix << 8 | (uint64_t)sub << 24 | (uint64_t)data << 32;
+    }
+    /** byte `i` as sent on the bus */
+    uint8_t byte(uint8_t i) const {
+        return raw() >> 8 * i;
+    }
     Message toMessage() {
         return {
-            .data = cmd | ix << 8 | sub << 24 | (uint64_t)data << 32,
+            .data = raw(),
             .id = (uint32_t)0x600 + nodeID,
             .opts = { .rtr = 0, .ide = 0, .dlc = 8},
         };
     }
-    static SDO fromMessage(Message msg) {
+    /** SDO from 8 raw bytes, e.g. for segments carrying 7 data bytes */
+    static SDO fromRaw(uint64_t d, uint8_t nodeID) {
         return {
-            .data = (uint32_t)(msg.data >> 32),
-            .ix = (uint16_t)(msg.data >> 8),
-            .sub = (uint8_t)(msg.data >> 24),
-            .cmd = (uint8_t)msg.data,
-            .nodeID = (uint8_t)(msg.id % 0x80),
+            .data = (uint32_t)(d >> 32),
+            .ix = (uint16_t)(d >> 8),
+            .sub = (uint8_t)(d >> 24),
+            .cmd = (uint8_t)d,
+            .nodeID = nodeID,
         };
     }
+    static SDO fromMessage(Message msg) {
+        return fromRaw(msg.data, msg.id % 0x80);
+    }
 };
+/** CANOpen SDO segmented or block transfer of a DO of arbitrary size */
+struct Transfer {
+    enum Kind : uint8_t {
+        DOWNLOAD,   ///< write to device
+        UPLOAD,     ///< read from device
+    } kind;
+    bool block;     ///< use block transfer
+    uint16_t ix;    ///< index of DO
+    uint8_t sub;    ///< subindex of DO
+    Buffer<uint8_t> data; ///< data to write, rsp. data read
+    uint32_t abort; ///< SDO abort code, 0 on success
+};
+/** CRC-16-CCITT over `len` bytes, as used by SDO block transfers */
+inline uint16_t crc16(const uint8_t *p, size_t len, uint16_t crc=0) {
+    while (len--) {
+        crc ^= (uint16_t)*p++ << 8;
+        for (int i = 0; i < 8; ++i) {
+            crc = crc & 0x8000 ? crc << 1 ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+/** write lowest `len` bits of `v` at bit `shift` of little endian `b` */
+inline void setBits(uint8_t *b, size_t shift, uint8_t len, uint64_t v) {
+    for (uint8_t i = 0; i < len;) {
+        size_t byte = (shift + i) / 8, bit = (shift + i) % 8;
+        uint8_t n = 8 - bit < (size_t)(len - i) ? 8 - bit : len - i;
+        uint8_t m = ((1U << n) - 1) << bit;
+        b[byte] = (b[byte] & ~m) | ((v >> i) << bit & m);
+        i += n;
+    }
+}
+/** read `len` bits at bit `shift` of little endian `b` */
+inline uint64_t getBits(const uint8_t *b, size_t shift, uint8_t len) {
+    uint64_t v = 0;
+    for (uint8_t i = 0; i < len;) {
+        size_t byte = (shift + i) / 8, bit = (shift + i) % 8;
+        uint8_t n = 8 - bit < (size_t)(len - i) ? 8 - bit : len - i;
+        v |= (uint64_t)(b[byte] >> bit & ((1U << n) - 1)) << i;
+        i += n;
+    }
+    return v;
+}
 /** Single Entry in PDO Data List */
 struct PDOMap {
     uint16_t ix;    ///< index of Data Object
@@ -69,14 +123,22 @@ struct RPDO {
     PDOType type;           ///< reception type
     uint32_t COB {};        ///< CAN OBject ID -- leave empty for defaults
     Buffer<PDOMap> map;     ///< PDO Data Map
+    bool brs {};            ///< bit rate switch for CAN FD PDOs
+    /** pack mapped data, PDOs longer than 8 bytes are sent as CAN FD */
     Message toMessage() const {
-        uint64_t data = 0;
-        uint8_t shift = 0;
+        Message msg{.id = COB};
+        memset(msg.bytes, 0, sizeof(msg.bytes));
+        size_t shift = 0;
         for (auto &i : map) {
-            data |= (i.data & (((uint64_t)1 << i.len)-1)) << shift;
+            assert(shift + i.len <= MAXLEN * 8);
+            setBits(msg.bytes, shift, i.len, i.data);
             shift += i.len;
         }
-        return {.data=data, .id = COB, .opts = {.dlc=(uint8_t)(shift / 8)}};
+        uint8_t len = (shift + 7) / 8;
+        msg.opts.fdf = len > 8;
+        msg.opts.brs = msg.opts.fdf && brs;
+        msg.opts.dlc = dlcOf(len);
+        return msg;
     }
 };
 /** CANOpen Transmit Process Data Object Type */
@@ -86,13 +148,18 @@ struct TPDO {
     uint32_t COB {};        ///< CAN OBject ID -- leave empty for defaults
     uint32_t inhibit_time;  ///< inhibit time in 0.1ms steps
     Buffer<PDOMap> map;     ///< PDO Data Map
-    void receive(uint64_t d) {
-        uint8_t shift = 0;
+    /** unpack mapped data from classic or CAN FD Message */
+    void receive(const Message &msg) {
+        size_t shift = 0, bits = msg.len() * 8;
         for (auto &i : map) {
-            i.data = d >> shift & (((uint64_t)1 << i.len) - 1);
+            if (shift + i.len > bits) break;
+            i.data = getBits(msg.bytes, shift, i.len);
             shift += i.len;
         }
     }
+    void receive(uint64_t d) {
+        receive(Message{.data = d, .opts = {.dlc = 8}});
+    }
 };
 
 /** CANOpen dispatch class
@@ -107,13 +174,82 @@ struct TPDO {
  */
 struct Dispatch : Sink<SDO>, Sink<Message> {
     enum LOGLEVEL { NONE, WARN, INFO} log;
-    Dispatch(CAN &can, LOGLEVEL=NONE) : can(can) { }
+    /** create dispatcher for up to `pdos` received PDOs [1 .. 254] */
+    Dispatch(CAN &can, LOGLEVEL log=NONE, size_t pdos=64)
+        : log(log), can(can), pdo(pdos) { }
     CAN &can;
     Sink<SDO> *ids[128] {};
+    /** last heartbeat state of each node */
+    STATE states[128] {};
+    /** time of last heartbeat of each node [ms], 0 if none yet */
+    uint32_t alive[128] {};
+    /** routing of received PDOs by COB-ID in constant time
+     *
+     * 11-bit COB-IDs index a table directly, 29-bit COB-IDs (> 0x7ff) are
+     * looked up in a hash table with linear probing
+     */
     struct PDO {
-        Sink<TPDO> *dev[8] {};
-        TPDO *pdo[8] {};
-        uint8_t n {};
+        struct Entry {
+            TPDO *pdo;
+            Sink<TPDO> *dev;
+        };
+        /** number of slots for 29-bit COB-IDs, power of 2 */
+        static constexpr size_t EXT = 64;
+        PDO(size_t n) : entries(n) {
+            assert(n > 0 && n < 255);
+        }
+        /** registered PDOs */
+        Buffer<Entry> entries;
+        /** entry index + 1 per 11-bit COB-ID, 0 if unused */
+        uint8_t cob[0x800] {};
+        struct Ext {
+            uint32_t id;
+            uint8_t ix;
+        } ext[EXT] {};
+        /** entry for given COB-ID, nullptr if unknown
+         *
+         * `ide` is the frame format, 29-bit frames never match an 11-bit
+         * COB-ID even if their identifier is <= 0x7ff
+         */
+        Entry *find(uint32_t id, bool ide) {
+            uint8_t ix = 0;
+            if (!ide) {
+                ix = id <= 0x7ff ? cob[id] : 0;
+            } else if (id > 0x7ff) {
+                auto e = probe(id);
+                ix = e ? e->ix : 0;
+            }
+            return ix ? &entries[ix - 1] : nullptr;
+        }
+        /** route given COB-ID to entry, replacing any previous route */
+        void route(uint32_t id, uint8_t ix) {
+            uint8_t *slot = &cob[id & 0x7ff];
+            if (id > 0x7ff) {
+                auto e = probe(id);
+                assert(e); // hash table full
+                e->id = id;
+                slot = &e->ix;
+            }
+            *slot = ix;
+        }
+        /** drop all routes and route all entries by their current COB-ID */
+        void reroute() {
+            memset(cob, 0, sizeof(cob));
+            memset(ext, 0, sizeof(ext));
+            for (size_t i = 0; i < entries.len; ++i) {
+                route(entries[i].pdo->COB, i + 1);
+            }
+        }
+    private:
+        /** slot holding `id` or the free slot for it, nullptr if full */
+        Ext *probe(uint32_t id) {
+            size_t h = (id * 2654435761U) >> 26;
+            for (size_t i = 0; i < EXT; ++i) {
+                auto &e = ext[(h + i) % EXT];
+                if (!e.ix || e.id == id) return &e;
+            }
+            return nullptr;
+        }
     } pdo;
 
     /** send NMT command to nodeid, rsp broadcast it (id = 0) */
@@ -140,6 +276,7 @@ struct Dispatch : Sink<SDO>, Sink<Message> {
             auto msg = can.pop();
             if (handlePDO(msg)) continue;
             if (handleSDO(msg)) continue;
+            if (handleHeartbeat(msg)) continue;
             // don't know what to do with received message!
             if (log > NONE) k.log.warn("unhandled: [id: %x] [%02x %02x %02x %02x %02x %02x %02x %02x]\n",
                     msg.id,
@@ -174,37 +311,61 @@ struct Dispatch : Sink<SDO>, Sink<Message> {
         assert(nodeID != 0);
         assert(ids[nodeID] == nullptr);
         ids[nodeID] = dev;
+        if (filtering) filter();
+    }
+    /** let the CAN backend drop all Messages not handled here
+     *
+     * accepts SDO responses and heartbeats of registered nodes and all
+     * registered PDOs, and is kept up to date on later registrations.
+     * Don't use if other Messages are read from the same bus.
+     */
+    void filter() {
+        filtering = true;
+        size_t n = pdo.entries.len;
+        for (auto dev : ids) n += dev ? 2 : 0;
+        Buffer<Filter> f = n;
+        for (uint32_t id = 1; id < 128; ++id) {
+            if (!ids[id]) continue;
+            f.append({0x580 + id, 0x7ff, false});
+            f.append({0x700 + id, 0x7ff, false});
+        }
+        for (auto &e : pdo.entries) {
+            bool ide = e.pdo->COB > 0x7ff;
+            f.append({e.pdo->COB, ide ? 0x1fffffffU : 0x7ffU, ide});
+        }
+        can.filter(f.buf, f.len);
     }
     void registerPDO(TPDO *tpdo, Sink<TPDO> *dev) {
-        for (uint8_t i = 0; i < pdo.n; i++) {
-            if (pdo.pdo[i] == tpdo) {
-                assert(pdo.dev[i] == dev);
-                return;
-            }
+        assert(tpdo->COB < 1U << 29);
+        size_t ix = 0;
+        while (ix < pdo.entries.len && pdo.entries[ix].pdo != tpdo) ix++;
+        if (ix == pdo.entries.len) {
+            pdo.entries.append({tpdo, dev});
+        } else {
+            assert(pdo.entries[ix].dev == dev);
+            // re-enabled with another COB-ID, drop stale routes
+            auto e = pdo.find(tpdo->COB, tpdo->COB > 0x7ff);
+            if (e != &pdo.entries[ix]) pdo.reroute();
         }
-        assert ( pdo.n < 8 );
-        pdo.dev[pdo.n] = dev;
-        pdo.pdo[pdo.n] = tpdo;
-        pdo.n += 1;
+        pdo.route(tpdo->COB, ix + 1);
+        if (filtering) filter();
     }
 
     bool handlePDO(Message msg) {
-        for (int i = 0; i < pdo.n; ++i) {
-            auto tpdo = pdo.pdo[i];
-            if (tpdo->COB == msg.id
-                    && msg.opts.dlc) {
-                tpdo->receive(msg.data);
-                pdo.dev[i]->push(*tpdo);
-                if (log > WARN) {
-                    k.log.info("handled PDO id: %x\n", msg.id);
-                    k.log.info("          data: %x\n", msg.data);
-                    k.log.info("    TPDO data0: %x\n",tpdo->map[0].data);
-                    k.log.info("    TPDO data1: %x\n",tpdo->map[1].data);
-                }
-                return true;
-            }
+        if (!msg.opts.dlc) return false;
+        auto e = pdo.find(msg.id, msg.opts.ide);
+        // stale route of a PDO re-enabled with another COB-ID
+        if (!e || e->pdo->COB != msg.id) return false;
+        auto tpdo = e->pdo;
+        tpdo->receive(msg);
+        e->dev->push(*tpdo);
+        if (log > WARN) {
+            k.log.info("handled PDO id: %x\n", msg.id);
+            k.log.info("          data: %x\n", msg.data);
+            k.log.info("    TPDO data0: %x\n",tpdo->map[0].data);
+            k.log.info("    TPDO data1: %x\n",tpdo->map[1].data);
         }
-        return false;
+        return true;
     }
     bool handleSDO(Message msg) {
         uint16_t service = msg.id & ~0x7f;
@@ -223,6 +384,18 @@ struct Dispatch : Sink<SDO>, Sink<Message> {
         }
         return false;
     }
+    bool handleHeartbeat(Message msg) {
+        uint8_t id = msg.id & 0x7f;
+        if (msg.opts.ide || (msg.id & ~0x7f) != 0x700 || id == 0
+                || msg.opts.dlc != 1) {
+            return false;
+        }
+        states[id] = (STATE)(msg.data & 0x7f);
+        alive[id] = k.time;
+        return true;
+    }
+private:
+    bool filtering{};
 };
 
 /** CANOpen device wrapper class
@@ -239,14 +412,69 @@ struct Device : Sink<TPDO>, Sink<SDO> {
     uint8_t const id {};    ///< CANOpen node ID [1 - 127]
     Dispatch &out;
 
+    /** SDO client state
+     *
+     * a single request is outstanding per Device, the next one is sent as
+     * soon as the response for its index and subindex, or an abort,
+     * arrived. Unanswered requests are retransmitted after `timeout`, and
+     * reported as aborted with code 0x05040000 after `retries`. Devices on
+     * different nodes proceed in parallel.
+     */
     struct State {
         Queue<SDO> q{60};
-        Deadline next{};
+        /** request waiting for its response */
+        SDO pending{};
+        bool waiting{};
+        uint8_t tries{};
+        uint32_t sent{};
+        /** transfers waiting to be started */
+        Queue<Transfer> xfers{4};
     } state;
+    /** time to wait for an SDO response [ms] */
+    uint32_t timeout{20};
+    /** number of retransmissions of unanswered expedited requests */
+    uint8_t retries{2};
+    /** longest upload accepted [bytes], longer ones are aborted with code
+     * 0x05040005 before their data is allocated */
+    size_t maxlen{65536};
     /** implement the callback method to handle incoming data */
     virtual void callback(SDO rq) { assert(false); };
     /** implement the callback method to handle incoming data */
     virtual void callback(TPDO rq) { assert(false); };
+    /** implement to handle finished transfers, see `download` / `upload`
+     *
+     * `t.abort` is 0 on success, and `t.data` holds the data read
+     */
+    virtual void completed(Transfer &&) { };
+    /** write `data` to DO with given index and subindex
+     *
+     * uses an SDO segmented transfer, or a block transfer with CRC if
+     * `block` is set. Runs asynchronously, reports to `completed`.
+     * Transfers start in order once no expedited request is queued, and
+     * take precedence over expedited requests while running. Transfers
+     * without response for `timeout` are aborted, transfers not fitting
+     * the queue of waiting ones are aborted with code 0x05040005 right away.
+     */
+    void download(uint16_t ix, uint8_t sub, Buffer<uint8_t> &&data, bool block=false) {
+        enqueue(Transfer{Transfer::DOWNLOAD, block, ix, sub, std::move(data), 0});
+    }
+    /** read DO of arbitrary size with given index and subindex
+     *
+     * see `download`
+     */
+    void upload(uint16_t ix, uint8_t sub, bool block=false) {
+        enqueue(Transfer{Transfer::UPLOAD, block, ix, sub, {}, 0});
+    }
+    /** handle timeouts, continue running transfer
+     *
+     * call recurringly, so lost responses are noticed and block transfers
+     * continue if the CAN bus is busy.
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void poll(uint32_t, uint32_t) {
+        if (x.phase == BLOCK && x.cur.kind == Transfer::DOWNLOAD) sendBlock();
+        process();
+    }
     /** read DO with given index and subindex of this device */
     void read(uint16_t ix, uint8_t sub) {
         pushorqueue({.ix=ix, .sub=sub, .cmd=0x40, .nodeID=id});
@@ -309,8 +537,16 @@ struct Device : Sink<TPDO>, Sink<SDO> {
     }
     using Sink<SDO>::push;
     void push(SDO &&sdo) override {
-        state.next = {0};
-        callback(std::move(sdo));
+        if (x.phase != IDLE) {
+            x.since = k.time;
+            transfer(sdo);
+        } else if (!state.waiting) {
+            callback(std::move(sdo));
+        } else if (sdo.ix == state.pending.ix && sdo.sub == state.pending.sub) {
+            state.waiting = false;
+            callback(std::move(sdo));
+        }
+        // else: late response to a retransmitted request, dropped
         process();
     }
     using Sink<TPDO>::push;
@@ -318,19 +554,263 @@ struct Device : Sink<TPDO>, Sink<SDO> {
         callback(std::move(pdo));
         process();
     }
+    /** handle timeouts, send next request if none is outstanding */
     void process() {
-        if (state.q.empty()) return;
-        if (state.next.when && !state.next(k.time)) return;
-        out.push(state.q.pop());
-        state.next = {k.time + 2};
+        expire();
+        if (x.phase != IDLE || state.waiting) return;
+        if (!state.q.empty()) {
+            state.pending = state.q.pop();
+            state.waiting = true;
+            state.tries = 0;
+            state.sent = k.time;
+            (*(Sink<SDO>*)&out).trypush(SDO{state.pending});
+        } else if (!state.xfers.empty()) {
+            start(state.xfers.pop());
+        }
     }
     void pushorqueue(SDO &&sdo) {
-        if (state.next.when && !state.next(k.time)) {
-            state.q.trypush(std::move(sdo));
+        state.q.trypush(std::move(sdo));
+        process();
+    }
+private:
+    /** SDO client command specifiers, cf. CiA 301 */
+    enum : uint8_t {
+        ABORT = 0x80,
+        BLOCK_SIZE = 127,
+        SEG = 7,    ///< data bytes per segment
+    };
+    enum Phase : uint8_t { IDLE, INIT, SEGMENT, BLOCK, ACK, END };
+    /** running transfer */
+    struct {
+        Transfer cur{};
+        Phase phase{};
+        uint8_t toggle{}, seq{}, blksize{};
+        bool crc{};
+        size_t off{}, blockStart{};
+        /** time of last activity */
+        uint32_t since{};
+    } x;
+    void enqueue(Transfer &&t) {
+        if (state.xfers.full()) {
+            t.abort = 0x05040005; // out of memory
+            completed(std::move(t));
+            return;
+        }
+        state.xfers.push(std::move(t));
+        process();
+    }
+    void send(uint64_t raw) {
+        x.since = k.time;
+        (*(Sink<SDO>*)&out).trypush(SDO::fromRaw(raw, id));
+    }
+    /** retransmit or give up unanswered request, abort stalled transfer */
+    void expire() {
+        if (state.waiting && k.time - state.sent >= timeout) {
+            state.sent = k.time;
+            if (state.tries < retries) {
+                state.tries++;
+                (*(Sink<SDO>*)&out).trypush(SDO{state.pending});
+            } else {
+                state.waiting = false;
+                SDO a = state.pending;
+                a.cmd = ABORT;
+                a.data = 0x05040000; // SDO protocol timed out
+                callback(std::move(a));
+            }
+        }
+        if (x.phase != IDLE && k.time - x.since >= timeout) finish(0x05040000);
+    }
+    /** raw segment with `n` data bytes from `p` after command byte `cmd` */
+    static uint64_t segment(uint8_t cmd, const uint8_t *p, size_t n) {
+        uint64_t raw = cmd;
+        for (size_t i = 0; i < n; ++i) raw |= (uint64_t)p[i] << 8 * (i + 1);
+        return raw;
+    }
+    uint64_t head(uint8_t cmd) {
+        return cmd | (uint64_t)x.cur.ix << 8 | (uint64_t)x.cur.sub << 24;
+    }
+    void start(Transfer &&t) {
+        x.cur = std::move(t);
+        x.phase = INIT;
+        x.toggle = x.seq = 0;
+        x.off = x.blockStart = 0;
+        auto &d = x.cur.data;
+        if (x.cur.kind == Transfer::UPLOAD) {
+            d.len = 0;
+            if (x.cur.block) send(head(0xa4) | (uint64_t)BLOCK_SIZE << 32);
+            else send(head(0x40));
+        } else if (x.cur.block) {
+            send(head(0xc6) | (uint64_t)d.len << 32);
+        } else if (d.len && d.len <= 4) {
+            // expedited, empty data goes segmented
+            uint64_t raw = head(0x23 | (4 - d.len) << 2);
+            for (size_t i = 0; i < d.len; ++i) raw |= (uint64_t)d.buf[i] << 8 * (4 + i);
+            send(raw);
         } else {
-            (*(Sink<SDO>*)&out).trypush(std::move(sdo));
-            state.next = {k.time + 2};
+            send(head(0x21) | (uint64_t)d.len << 32);
+        }
+    }
+    /** end running transfer, abort it with given code unless 0 */
+    void finish(uint32_t abort=0) {
+        if (abort) send(head(ABORT) | (uint64_t)abort << 32);
+        x.phase = IDLE;
+        Transfer t = std::move(x.cur);
+        t.abort = abort;
+        completed(std::move(t));
+    }
+    /** make room for `n` more bytes of uploaded data
+     *
+     * false if that exceeds `maxlen` by more than `slack` bytes
+     */
+    bool reserve(size_t n, size_t slack=0) {
+        auto &d = x.cur.data;
+        if (d.len + n > maxlen + slack) return false;
+        if (d.size - d.len >= n) return true;
+        size_t sz = d.len + n > 2 * d.size ? d.len + n : 2 * d.size;
+        if (sz > maxlen + slack) sz = maxlen + slack;
+        Buffer<uint8_t> more = sz;
+        memcpy(more.buf, d.buf, d.len);
+        more.len = d.len;
+        d = std::move(more);
+        return true;
+    }
+    void sendSegment() {
+        auto &d = x.cur.data;
+        size_t n = d.len - x.off < SEG ? d.len - x.off : SEG;
+        bool last = x.off + n == d.len;
+        send(segment(x.toggle << 4 | (SEG - n) << 1 | last, d.buf + x.off, n));
+    }
+    /** send segments of current block, as far as the bus allows */
+    void sendBlock() {
+        auto &d = x.cur.data;
+        while (x.seq < x.blksize && x.off < d.len && !full()) {
+            size_t n = d.len - x.off < SEG ? d.len - x.off : SEG;
+            bool last = x.off + n == d.len;
+            send(segment(last << 7 | ++x.seq, d.buf + x.off, n));
+            x.off += n;
+        }
+        if (x.seq == x.blksize || x.off == d.len) x.phase = ACK;
+    }
+    /** handle response to running transfer */
+    void transfer(const SDO &r) {
+        auto &d = x.cur.data;
+        uint8_t cmd = r.cmd;
+        if ((x.phase == INIT || cmd == ABORT)
+                && (r.ix != x.cur.ix || r.sub != x.cur.sub)) {
+            // late response to an earlier request, dropped
+            return;
+        }
+        if (cmd == ABORT) {
+            x.phase = IDLE;
+            Transfer t = std::move(x.cur);
+            t.abort = r.data ? r.data : 0x08000000;
+            completed(std::move(t));
+            return;
+        }
+        bool up = x.cur.kind == Transfer::UPLOAD;
+        if (!x.cur.block && !up) {
+            // segmented download
+            if (x.phase == INIT && cmd == 0x60) {
+                if (d.len && d.len <= 4) return finish();
+                x.phase = SEGMENT;
+                return sendSegment();
+            }
+            if (x.phase == SEGMENT && (cmd & 0xe0) == 0x20) {
+                if ((cmd >> 4 & 1) != x.toggle) return finish(0x05030000);
+                x.off += d.len - x.off < SEG ? d.len - x.off : SEG;
+                if (x.off == d.len) return finish();
+                x.toggle ^= 1;
+                return sendSegment();
+            }
+        } else if (!x.cur.block) {
+            // segmented upload
+            if (x.phase == INIT && (cmd & 0xe0) == 0x40) {
+                if (cmd & 2) {
+                    // expedited response
+                    size_t n = cmd & 1 ? 4 - (cmd >> 2 & 3) : 4;
+                    if (!reserve(n)) return finish(0x05040005);
+                    for (size_t i = 0; i < n; ++i) d.buf[d.len++] = r.byte(4 + i);
+                    return finish();
+                }
+                if (!reserve(cmd & 1 ? r.data : SEG)) return finish(0x05040005);
+                x.phase = SEGMENT;
+                return send(0x60);
+            }
+            if (x.phase == SEGMENT && (cmd & 0xe0) == 0x00) {
+                if ((cmd >> 4 & 1) != x.toggle) return finish(0x05030000);
+                size_t n = SEG - (cmd >> 1 & 7);
+                if (!reserve(n)) return finish(0x05040005);
+                for (size_t i = 0; i < n; ++i) d.buf[d.len++] = r.byte(1 + i);
+                if (cmd & 1) return finish();
+                x.toggle ^= 1;
+                return send(0x60 | x.toggle << 4);
+            }
+        } else if (!up) {
+            // block download
+            if (x.phase == INIT && (cmd & 0xe3) == 0xa0) {
+                x.crc = cmd & 4;
+                x.blksize = r.byte(4);
+                x.phase = BLOCK;
+                return sendBlock();
+            }
+            if ((x.phase == ACK || x.phase == BLOCK) && cmd == 0xa2) {
+                uint8_t acked = r.byte(1);
+                if (acked > x.seq) return finish(0x05040003);
+                // resend from first segment not acknowledged
+                x.off = x.blockStart + acked * SEG;
+                if (x.off > d.len) x.off = d.len;
+                x.blockStart = x.off;
+                x.seq = 0;
+                x.blksize = r.byte(2);
+                if (x.off == d.len) {
+                    size_t last = d.len ? d.len - (d.len - 1) / SEG * SEG : 0;
+                    uint16_t crc = x.crc ? crc16(d.buf, d.len) : 0;
+                    x.phase = END;
+                    return send(0xc1 | (SEG - last) << 2 | (uint64_t)crc << 8);
+                }
+                x.phase = BLOCK;
+                return sendBlock();
+            }
+            if (x.phase == END && cmd == 0xa1) return finish();
+        } else {
+            // block upload
+            if (x.phase == INIT && (cmd & 0xf9) == 0xc0) {
+                x.crc = cmd & 4;
+                // segments are stored whole, the last one is trimmed at END
+                if (cmd & 2 && r.data > maxlen) return finish(0x05040005);
+                reserve((cmd & 2 ? r.data : 0) + SEG, SEG);
+                x.blksize = BLOCK_SIZE;
+                x.phase = BLOCK;
+                return send(0xa3);
+            }
+            if (x.phase == BLOCK) {
+                // segments carry their sequence number instead of a command,
+                // everything after a lost segment is dropped and resent
+                bool inseq = (cmd & 0x7f) == x.seq + 1;
+                if (inseq) {
+                    x.seq++;
+                    if (!reserve(SEG, SEG)) return finish(0x05040005);
+                    for (size_t i = 0; i < SEG; ++i) d.buf[d.len++] = r.byte(1 + i);
+                }
+                if (x.seq == x.blksize || cmd & 0x80 || (cmd & 0x7f) == x.blksize) {
+                    send(0xa2 | x.seq << 8 | (uint64_t)x.blksize << 16);
+                    x.seq = 0;
+                    if (inseq && cmd & 0x80) x.phase = END;
+                }
+                return;
+            }
+            if (x.phase == END && (cmd & 0xe3) == 0xc1) {
+                size_t unused = cmd >> 2 & 7;
+                d.len = d.len >= unused ? d.len - unused : 0;
+                if (d.len > maxlen) return finish(0x05040005);
+                if (x.crc && crc16(d.buf, d.len) != (uint16_t)(r.raw() >> 8)) {
+                    return finish(0x05040004);
+                }
+                send(0xa1);
+                return finish();
+            }
         }
+        finish(0x05040001); // unexpected command
     }
 };
 }
@@ -0,0 +1,263 @@
+/** @file compress.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include "frameregistry.h"
+
+#include <utils/queue.h>
+
+/** Frame payload compression for slow links
+ *
+ * telemetry mostly consists of slowly varying values. Every Frame payload is
+ * XORed with the previous payload of the same id, which leaves mostly zero
+ * bytes, that are then suppressed by packing: every group of up to 8 bytes is
+ * preceded by a bitmask of its nonzero bytes, only those follow.
+ *
+ * Compressed Frames keep their id and carry a small header:
+ * ```
+ *  [mode][seq] payload            mode RAW:   payload as is
+ *  [mode][seq][len] packed        mode KEY:   packed payload
+ *                                 mode DELTA: packed XOR with previous payload
+ * ```
+ * `seq` counts Frames per id, a DELTA Frame is only decoded if its
+ * predecessor was received, so lost Frames are dropped until the next RAW or
+ * KEY Frame, which is sent every `keyframe` Frames per id.
+ *
+ * Compression is negotiated per connection: both directions pass Frames
+ * through untouched, until the other side enables compression with a Frame
+ * `[1]` on the control id, `[0]` disables it again. Every request is
+ * answered with the new state and the ACK flag set on the same id, answers
+ * are not answered. Frames whose encoding would not fit a transport Frame of
+ * MAXLEN bytes are dropped and counted.
+ * ```
+ *      Min min{.in=uart, .out=uart};
+ *      Compress zip{min.in, min.out};
+ *      zip.registerWith(min.reg, 62);
+ *      ...
+ *      zip.out.push(telemetry); // instead of min.out
+ * ```
+ * \note Frames received through `min.in` still need to go through `zip.in`
+ * to be decompressed, so poll `zip.in` instead of `min.in`
+ */
+struct Compress {
+    enum Mode : uint8_t { RAW, KEY, DELTA };
+    /** largest transport Frame payload, Min sends its length as a byte */
+    static constexpr size_t MAXLEN = 255;
+    /** flag of control Frames answering a request */
+    static constexpr uint8_t ACK = 0x80;
+    /** Frame payload codec state, one direction */
+    struct Codec {
+        /** previous payload per id */
+        Buffer<uint8_t> *last[64]{};
+        /** sequence number per id */
+        uint8_t seq[64]{};
+        ~Codec() { reset(); }
+        /** forget all history */
+        void reset() {
+            for (auto &l: last) {
+                delete l;
+                l = nullptr;
+            }
+            memset(seq, 0, sizeof(seq));
+        }
+        /** get previous payload of id */
+        Buffer<uint8_t> &history(uint8_t id) {
+            assert(id < 64);
+            if (!last[id]) last[id] = new Buffer<uint8_t>(256);
+            return *last[id];
+        }
+        /** pack `n` bytes of `in` into `out`, return packed length */
+        static size_t pack(const uint8_t *in, size_t n, uint8_t *out) {
+            size_t o = 0;
+            for (size_t g = 0; g < n; g += 8) {
+                size_t mask = o++;
+                out[mask] = 0;
+                for (size_t i = 0; i < 8 && g + i < n; ++i) {
+                    if (in[g+i]) {
+                        out[mask] |= 1 << i;
+                        out[o++] = in[g+i];
+                    }
+                }
+            }
+            return o;
+        }
+        /** unpack `n` bytes from `in` of length `len` into `out`
+         *
+         * return false if `in` was too short
+         */
+        static bool unpack(const uint8_t *in, size_t len, uint8_t *out, size_t n) {
+            size_t o = 0;
+            for (size_t g = 0; g < n; g += 8) {
+                if (o >= len) return false;
+                uint8_t mask = in[o++];
+                for (size_t i = 0; i < 8 && g + i < n; ++i) {
+                    if (mask & 1 << i) {
+                        if (o >= len) return false;
+                        out[g+i] = in[o++];
+                    } else {
+                        out[g+i] = 0;
+                    }
+                }
+            }
+            return o == len;
+        }
+    };
+
+    /** compressing Frame Sink, wraps underlying Frame Sink */
+    struct Out : Sink<Frame> {
+        Sink<Frame> &out;
+        Codec codec;
+        /** number of Frames per id between KEY Frames, 0 for none */
+        uint8_t keyframe{16};
+        bool enabled{};
+        /** id of control Frames, never compressed */
+        uint8_t control{0xff};
+        /** number of Frames dropped for not fitting a transport Frame */
+        size_t dropped{};
+        Out(Sink<Frame> &out) : out(out) { }
+        bool full() override {
+            return out.full();
+        }
+        using Sink<Frame>::push;
+        void push(Frame &&f) override {
+            if (!enabled || f.id == control) return out.push(std::move(f));
+            Frame c;
+            if (encode(f, c)) {
+                out.push(std::move(c));
+            } else {
+                dropped++;
+            }
+        }
+        /** compress Frame into `ret`
+         *
+         * return false if it does not fit a transport Frame of MAXLEN
+         */
+        bool encode(const Frame &f, Frame &ret) {
+            const size_t n = f.b.len;
+            if (n > MAXLEN) return false;
+            auto &last = codec.history(f.id);
+            uint8_t seq = codec.seq[f.id];
+            bool delta = last.len == n && (!keyframe || seq % keyframe);
+
+            ret.id = f.id;
+            ret.b = Buffer<uint8_t>(n + n / 8 + 4);
+            uint8_t *x = ret.b.buf + 3;
+            if (delta) {
+                for (size_t i = 0; i < n; ++i) x[i] = f.b[i] ^ last[i];
+            } else {
+                memcpy(x, f.b.buf, n);
+            }
+            uint8_t packed[256 + 256 / 8];
+            size_t plen = Codec::pack(x, n, packed);
+            bool fitsPacked = 3 + plen <= MAXLEN, fitsRaw = 2 + n <= MAXLEN;
+            if (!fitsPacked && !fitsRaw) return false;
+            if (fitsPacked && (plen + 1 < n || delta || !fitsRaw)) {
+                ret.b.buf[0] = delta ? DELTA : KEY;
+                ret.b.buf[1] = seq;
+                ret.b.buf[2] = n;
+                memcpy(x, packed, plen);
+                ret.b.len = 3 + plen;
+            } else {
+                ret.b.buf[0] = RAW;
+                ret.b.buf[1] = seq;
+                memcpy(ret.b.buf + 2, f.b.buf, n);
+                ret.b.len = 2 + n;
+            }
+            codec.seq[f.id]++;
+            memcpy(last.buf, f.b.buf, n);
+            last.len = n;
+            return true;
+        }
+    };
+
+    /** decompressing Frame Source, wraps underlying Frame Source */
+    struct In : Source<Frame> {
+        Source<Frame> &in;
+        Codec codec;
+        bool enabled{};
+        /** id of control Frames, never compressed */
+        uint8_t control{0xff};
+        /** number of Frames dropped for missing their reference */
+        size_t dropped{};
+        Queue<Frame> q{4};
+        In(Source<Frame> &in) : in(in) { }
+        bool empty() override {
+            while (q.empty() && !in.empty()) {
+                Frame f = in.pop();
+                if (!enabled || f.id == control) {
+                    q.push(std::move(f));
+                } else if (decode(f)) {
+                    q.push(std::move(f));
+                } else {
+                    dropped++;
+                }
+            }
+            return q.empty();
+        }
+        Frame pop() override {
+            return q.pop();
+        }
+        void notify(Signal &s) override {
+            in.notify(s);
+        }
+        /** decompress Frame in place, return false if impossible */
+        bool decode(Frame &f) {
+            if (f.b.len < 2) return false;
+            uint8_t mode = f.b[0], seq = f.b[1];
+            auto &last = codec.history(f.id);
+            uint8_t expect = codec.seq[f.id];
+            Buffer<uint8_t> out = 256;
+            if (mode == RAW) {
+                out.len = f.b.len - 2;
+                memcpy(out.buf, f.b.buf + 2, out.len);
+            } else {
+                if (f.b.len < 3) return false;
+                out.len = f.b[2];
+                if (!Codec::unpack(f.b.buf + 3, f.b.len - 3, out.buf, out.len)) {
+                    return false;
+                }
+                if (mode == DELTA) {
+                    if (seq != expect || last.len != out.len) return false;
+                    for (size_t i = 0; i < out.len; ++i) out[i] ^= last[i];
+                } else if (mode != KEY) {
+                    return false;
+                }
+            }
+            codec.seq[f.id] = seq + 1;
+            memcpy(last.buf, out.buf, out.len);
+            last.len = out.len;
+            f.b = std::move(out);
+            return true;
+        }
+    };
+
+    /** incoming decompressed Frame stream */
+    In in;
+    /** outgoing compressed Frame stream */
+    Out out;
+    /** wrap Frame streams of a connection */
+    Compress(Source<Frame> &from, Sink<Frame> &to) : in(from), out(to) { }
+    /** handle negotiation Frames with given id */
+    void registerWith(FrameRegistry &reg, uint8_t id) {
+        in.control = out.control = id;
+        reg.setHandler(id, *this, &Compress::handleFrame);
+    }
+    /** enable / disable compression in both directions */
+    void enable(bool on) {
+        if (on != out.enabled) {
+            in.codec.reset();
+            out.codec.reset();
+        }
+        in.enabled = out.enabled = on;
+    }
+private:
+    void handleFrame(Frame &f) {
+        uint8_t req = f.unpack<uint8_t>();
+        enable(req & 1);
+        if (req & ACK) return;
+        Frame ack{out.control};
+        ack.pack<uint8_t>(ACK | out.enabled);
+        out.trypush(std::move(ack));
+    }
+};
@@ -0,0 +1,149 @@
+/** @file crc.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/** CRC32 (IEEE 802.3, reflected) calculation engines
+ *
+ * every engine implements
+ * ```
+ *      // continue checksum `crc` over `n` bytes at `p`
+ *      static uint32_t update(uint32_t crc, const uint8_t *p, size_t n);
+ * ```
+ * on the reflected, not inverted state, and produces identical results.
+ * The engine used by CRC32 is selected at compile time:
+ *  - Slice8 by default, 8KiB of tables, 8 bytes per step
+ *  - Nibble if `TOOL_LIBS_CRC32_NIBBLE` is defined (`CRC32_NIBBLE` cmake
+ *  option, always set for STM builds), 64B of table, for flash
+ *  constrained targets
+ *  - Hardware if `TOOL_LIBS_CRC32_HW` is defined, implemented by the
+ *  platform, see e.g. stm/crc.cpp (`tool-libs-stm-crc` target). Takes
+ *  precedence over Nibble
+ */
+namespace CRC {
+/** reflected polynomial */
+constexpr uint32_t POLY = 0xedb88320U;
+
+/** reference implementation, one bit at a time */
+struct Bitwise {
+    static constexpr uint32_t step(uint32_t crc, int bits) {
+        for (int j = 0; j < bits; j++) {
+            uint32_t mask = (uint32_t) -(crc & 1U);
+            crc = (crc >> 1) ^ (POLY & mask);
+        }
+        return crc;
+    }
+    static uint32_t update(uint32_t crc, const uint8_t *p, size_t n) {
+        while (n--) crc = step(crc ^ *p++, 8);
+        return crc;
+    }
+};
+
+/** lookup table for Nibble */
+struct NibbleTable { uint32_t t[16]; };
+constexpr NibbleTable mkNibbleTable() {
+    NibbleTable ret{};
+    for (uint32_t i = 0; i < 16; ++i) ret.t[i] = Bitwise::step(i, 4);
+    return ret;
+}
+/** lookup tables for Slice8 */
+struct Slice8Table { uint32_t t[8][256]; };
+constexpr Slice8Table mkSlice8Table() {
+    Slice8Table ret{};
+    for (uint32_t i = 0; i < 256; ++i) ret.t[0][i] = Bitwise::step(i, 8);
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int k = 1; k < 8; ++k) {
+            uint32_t prev = ret.t[k-1][i];
+            ret.t[k][i] = (prev >> 8) ^ ret.t[0][prev & 0xff];
+        }
+    }
+    return ret;
+}
+
+/** one nibble at a time, 16 entry table */
+struct Nibble {
+    static constexpr NibbleTable table = mkNibbleTable();
+    static uint32_t update(uint32_t crc, const uint8_t *p, size_t n) {
+        while (n--) {
+            crc ^= *p++;
+            crc = (crc >> 4) ^ table.t[crc & 0xf];
+            crc = (crc >> 4) ^ table.t[crc & 0xf];
+        }
+        return crc;
+    }
+};
+
+/** slicing-by-8, 8 x 256 entry tables */
+struct Slice8 {
+    static constexpr Slice8Table table = mkSlice8Table();
+    static uint32_t le32(const uint8_t *p) {
+        return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t) p[3] << 24;
+    }
+    static uint32_t update(uint32_t crc, const uint8_t *p, size_t n) {
+        const auto &t = table.t;
+        for (; n >= 8; n -= 8, p += 8) {
+            uint32_t lo = le32(p) ^ crc, hi = le32(p + 4);
+            crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff]
+                ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24]
+                ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff]
+                ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+        }
+        while (n--) crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+        return crc;
+    }
+};
+
+/** feed `n` bytes at `p` to a CRC unit taking 32bit words MSB first
+ *
+ * `unit` provides `word(uint32_t)` and `byte(uint8_t)`, see stm/crc.cpp.
+ * Words are packed big endian, so the bytes enter the unit in memory order
+ */
+template<typename Unit>
+void feed(Unit &unit, const uint8_t *p, size_t n) {
+    for (; n >= 4; n -= 4, p += 4) {
+        unit.word((uint32_t) p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]);
+    }
+    while (n--) unit.byte(*p++);
+}
+
+/** hardware CRC unit, implemented by the platform */
+struct Hardware {
+    static uint32_t update(uint32_t crc, const uint8_t *p, size_t n);
+};
+
+#if defined(TOOL_LIBS_CRC32_HW)
+using Default = Hardware;
+#elif defined(TOOL_LIBS_CRC32_NIBBLE)
+using Default = Nibble;
+#else
+using Default = Slice8;
+#endif
+}
+
+/** CRC32 checksum using given engine, see namespace CRC */
+template<typename Engine=CRC::Default>
+struct BasicCRC32 {
+    /** state */
+    uint32_t checksum{0xffffffff};
+    /** reinitialize state */
+    void init() {
+        *this = BasicCRC32{};
+    }
+    /** calculate step with given byte */
+    void step(uint8_t byte) {
+        checksum = Engine::update(checksum, &byte, 1);
+    }
+    /** calculate steps with `len` bytes of `buf` */
+    void update(const uint8_t *buf, size_t len) {
+        checksum = Engine::update(checksum, buf, len);
+    }
+    /** get final CRC32 value */
+    uint32_t finalize() {
+        return ~checksum;
+    }
+};
+/** CRC32 using the engine selected at compile time */
+using CRC32 = BasicCRC32<>;
@@ -0,0 +1,185 @@
+/** @file fragment.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include "frameregistry.h"
+
+#include <utils/queue.h>
+
+/** fragmentation of large messages into Frames
+ *
+ * messages of arbitrary size are split into Frames of maximal Min length,
+ * all sent with the same Frame id, and reassembled into a single Buffer on
+ * the other side. Every Frame carries the header
+ * ```
+ *      [message id: u8][offset: u32][total length: u32] data
+ * ```
+ * Only `budget` Frames are sent per call of `Out::poll`, so other Frames,
+ * e.g. heartbeats, can go out in between. Fragments must arrive in order,
+ * a message with a missing fragment is dropped. Use Min::Transport
+ * underneath, if fragments must not get lost.
+ * ```
+ *      // sending side
+ *      Fragment::Out up{min.out, 60};
+ *      k.every(1, up, &Fragment::Out::poll);
+ *      up.push({.id=1, .data=std::move(trajectory)});
+ *
+ *      // receiving side
+ *      Fragment::In down;
+ *      down.registerWith(min.reg, 60);
+ *      down.reserve(1, Buffer<uint8_t>(4096)); // optional
+ *      while (!down.empty()) {
+ *          auto msg = down.pop();
+ *          ...
+ *      }
+ * ```
+ */
+namespace Fragment {
+/** a whole message */
+struct Message {
+    /** message id: [0..MAX) */
+    uint8_t id{};
+    /** message content */
+    Buffer<uint8_t> data{};
+};
+/** maximum number of distinct message ids */
+constexpr size_t MAX = 16;
+/** length of fragment header */
+constexpr size_t HEADER = 9;
+/** maximum payload of a Min Frame */
+constexpr size_t FRAMELEN = 255;
+
+/** split messages into Frames */
+struct Out : Sink<Message> {
+    /** maximum number of Frames sent per `poll` */
+    size_t budget;
+    /** create fragmenter pushing Frames with given id */
+    Out(Sink<Frame> &out, uint8_t id, size_t budget=4, size_t backlog=4)
+        : budget(budget), out(out), id(id), q(backlog) { }
+    bool full() override {
+        return q.full();
+    }
+    using Sink<Message>::push;
+    /** queue message for sending */
+    void push(Message &&m) override {
+        assert(m.id < MAX);
+        q.push(std::move(m));
+    }
+    /** send next fragments
+     *
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void poll(uint32_t, uint32_t) {
+        for (size_t n = 0; n < budget && !q.empty() && !out.full(); ++n) {
+            auto &m = q.front();
+            size_t len = m.data.len - off;
+            if (len > FRAMELEN - HEADER) len = FRAMELEN - HEADER;
+            Frame f{id};
+            f.b = Buffer<uint8_t>(FRAMELEN + 1);
+            f.pack<uint8_t>(m.id)
+                .pack<uint32_t>(off)
+                .pack<uint32_t>(m.data.len);
+            memcpy(f.b.buf + HEADER, m.data.buf + off, len);
+            f.b.len += len;
+            out.push(std::move(f));
+            off += len;
+            if (off == m.data.len) {
+                q.drop();
+                off = 0;
+            }
+        }
+    }
+    /** true if no message is being sent */
+    bool idle() {
+        return q.empty();
+    }
+private:
+    Sink<Frame> &out;
+    const uint8_t id;
+    Queue<Message> q;
+    size_t off{};
+};
+
+/** reassemble messages from Frames */
+struct In : Source<Message> {
+    /** number of messages dropped for missing fragments, exceeding
+     * `maxlen`, or finished while `backlog` messages were waiting */
+    size_t lost{};
+    /** longest message a Buffer is allocated for, see `reserve` */
+    const size_t maxlen;
+    In(size_t backlog=4, size_t maxlen=65536) : maxlen(maxlen), done(backlog) { }
+    /** receive fragments with given Frame id */
+    void registerWith(FrameRegistry &reg, uint8_t id) {
+        reg.setHandler(id, *this, &In::handleFrame);
+    }
+    /** provide destination for the next message with given id
+     *
+     * the Buffer is used if it is large enough for the message, otherwise
+     * a Buffer of the exact size, at most `maxlen`, is allocated on the
+     * first fragment
+     */
+    void reserve(uint8_t msg, Buffer<uint8_t> &&dst) {
+        assert(msg < MAX);
+        part[msg].data = std::move(dst);
+        part[msg].data.len = 0;
+    }
+    bool empty() override {
+        return done.empty();
+    }
+    Message pop() override {
+        return done.pop();
+    }
+    /** handle single fragment */
+    void handleFrame(Frame &f) {
+        if (f.b.len < HEADER) return;
+        uint8_t msg = f.unpack<uint8_t>();
+        uint32_t off = f.unpack<uint32_t>();
+        uint32_t total = f.unpack<uint32_t>();
+        size_t len = f.b.len - HEADER;
+        if (msg >= MAX) return;
+        auto &p = part[msg];
+        if (off == 0) {
+            if (p.active) lost++;
+            if (p.data.size < total && total > maxlen) {
+                lost++;
+                p.active = false;
+                p.total = total;
+                return;
+            }
+            if (p.data.size < total) p.data = Buffer<uint8_t>(total);
+            p.data.len = 0;
+            p.total = total;
+            p.active = true;
+        } else if (!p.active || off != p.data.len || total != p.total) {
+            // count every broken message once
+            if (p.active || p.total != total) lost++;
+            p.active = false;
+            p.total = total;
+            return;
+        }
+        if (off + len > total) {
+            lost++;
+            p.active = false;
+            return;
+        }
+        memcpy(p.data.buf + off, f.b.buf + HEADER, len);
+        p.data.len += len;
+        if (p.data.len == total) {
+            p.active = false;
+            if (done.full()) {
+                lost++;
+            } else {
+                done.push(Message{msg, std::move(p.data)});
+            }
+        }
+    }
+private:
+    struct Partial {
+        Buffer<uint8_t> data{};
+        uint32_t total{};
+        bool active{};
+    } part[MAX];
+    Queue<Message> done;
+};
+}
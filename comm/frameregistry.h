@@ -4,7 +4,8 @@
  */
 #pragma once
 
-#include <utils/buffer.h>
+#include <cstdint>
+#include <utils/queue.h>
 
 /** pyWisp communication frame */
 struct Frame {
@@ -12,6 +13,8 @@ struct Frame {
     Buffer<uint8_t> b = 128;
     /** buffer id: [0..63] */
     uint8_t id{};
+    /** sequence number of transport Frames, see Min::Transport */
+    uint8_t seq{};
     /** construct Frame with given id */
     Frame(uint8_t id=0) : id(id) { }
     /** pack value into Frame
@@ -51,53 +54,95 @@ struct Frame {
         cursor.unpack += sz;
         return ret;
     }
+    /** restart unpacking from the beginning */
+    void rewind() {
+        cursor.unpack = 0;
+    }
+    /** reserve `n` bytes at the pack cursor, return where to write them */
+    uint8_t *packRaw(size_t n) {
+        assert(cursor.pack + n <= b.size);
+        uint8_t *ret = b.buf + cursor.pack;
+        cursor.pack += n;
+        b.len += n;
+        return ret;
+    }
+    /** consume `n` bytes at the unpack cursor, return where to read them
+     *
+     * returns nullptr if fewer than `n` bytes are left
+     */
+    const uint8_t *unpackRaw(size_t n) {
+        if (cursor.unpack + n > b.len) return nullptr;
+        const uint8_t *ret = b.buf + cursor.unpack;
+        cursor.unpack += n;
+        return ret;
+    }
 private:
     struct {
         uint8_t pack, unpack;
     } cursor{};
 };
 
-/** Registry for dispatching frames to their registered destinations */
+/** Registry for dispatching frames to their registered destinations
+ *
+ * any number of functions or methods can subscribe to each id, they are
+ * called in order of subscription. Bindings live in a fixed table, calling
+ * them costs one indirect call, no heap or virtual dispatch.
+ *
+ * Frames of ids marked with `defer` are queued instead, and handled once
+ * `dispatch` is called, e.g. from a lower priority task:
+ * ```
+ *      min.reg.subscribe(1, experiment, &Experiment::handleFrame);
+ *      min.reg.subscribe(1, logger, &Recorder::onExperimentFrame);
+ *      min.reg.defer(40, 16); // bulk data
+ *      k.every(10, min.reg, &FrameRegistry::poll);
+ * ```
+ */
 struct FrameRegistry {
-    /** Virtual Base for a callable Frame handler */
-    struct FrameHandler {
-        virtual ~FrameHandler(){}
-        virtual void handle(Frame &f)=0;
-    };
-    /** pure function FrameHandler */
-    struct FuncHandler: public FrameHandler {
-        typedef void (*Func)(Frame &f);
-        Func func{};
-        FuncHandler(Func f) : func(f) { }
-        void handle(Frame &f) override {
-            return func(f);
-        }
-    };
-    /** class method FrameHandler */
+    /** signature of function handlers */
+    using Func = void (*)(Frame &f);
+    /** signature of method handlers */
     template<typename T>
-    struct MethodHandler: public FrameHandler {
-        typedef void(T::*Method)(Frame &f);
-        T* base;
-        Method method;
-        MethodHandler(T* b, Method m) : base(b), method(m) { }
-        void handle(Frame &f) override {
-            return (base->*method)(f);
-        }
-    };
+    using Method = void (T::*)(Frame &f);
+    /** maximum number of subscriptions over all ids */
+    static constexpr size_t MAX = 64;
 
-    /** list of registered handlers */
-    FrameHandler *list[64]{};
-    /** register pure function FrameHandler for given id */
-    void setHandler(uint8_t id, FuncHandler::Func f) {
-        assert(list[id] == nullptr);
-        list[id] = new FuncHandler(f);
-    }
-    /** register class method FrameHandler for given id */
+    /** subscribe function to given id */
+    void subscribe(uint8_t id, Func f) {
+        Binding &b = add(id);
+        static_assert(sizeof(f) <= sizeof(b.fn));
+        memcpy(b.fn, &f, sizeof(f));
+        b.call = [](const Binding &b, Frame &f) {
+            Func func;
+            memcpy(&func, b.fn, sizeof(func));
+            func(f);
+        };
+    }
+    /** subscribe class method to given id */
     template<typename T>
-    void setHandler(uint8_t id, T& base,
-            typename MethodHandler<T>::Method method) {
-        assert(list[id] == nullptr);
-        list[id] = new MethodHandler(&base, method);
+    void subscribe(uint8_t id, T& base, Method<T> method) {
+        Binding &b = add(id);
+        static_assert(sizeof(method) <= sizeof(b.fn));
+        b.obj = &base;
+        memcpy(b.fn, &method, sizeof(method));
+        b.call = [](const Binding &b, Frame &f) {
+            Method<T> m;
+            memcpy(&m, b.fn, sizeof(m));
+            (static_cast<T *>(b.obj)->*m)(f);
+        };
+    }
+    /** register pure function handler for given id, see `subscribe` */
+    void setHandler(uint8_t id, Func f) {
+        subscribe(id, f);
+    }
+    /** register class method handler for given id, see `subscribe` */
+    template<typename T>
+    void setHandler(uint8_t id, T& base, Method<T> method) {
+        subscribe(id, base, method);
+    }
+    /** queue up to `depth` Frames of given id until `dispatch` */
+    void defer(uint8_t id, size_t depth) {
+        assert(id < 64 && !deferred[id]);
+        deferred[id] = new Queue<Frame>(depth);
     }
 
     /** handle given Frame and consume it
@@ -106,12 +151,69 @@ struct FrameRegistry {
      * to have the compiler let you do this.
      */
     void handle(Frame &&f) {
-        FrameHandler *c = list[f.id];
-        if (c) c->handle(f);
+        if (f.id >= 64) return;
+        if (deferred[f.id]) {
+            deferred[f.id]->trypush(std::move(f));
+            return;
+        }
+        call(f);
+    }
+    /** handle up to `max` deferred Frames, return number handled */
+    size_t dispatch(size_t max=SIZE_MAX) {
+        size_t n = 0;
+        for (bool any = true; any && n < max;) {
+            any = false;
+            for (auto q : deferred) {
+                if (!q || q->empty() || n == max) continue;
+                Frame f = q->pop();
+                call(f);
+                any = true;
+                ++n;
+            }
+        }
+        return n;
     }
+    /** handle all deferred Frames
+     *
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void poll(uint32_t, uint32_t) {
+        dispatch();
+    }
+    FrameRegistry() {
+        memset(first, NONE, sizeof(first));
+    }
+    FrameRegistry(const FrameRegistry &) = delete;
+    FrameRegistry &operator=(const FrameRegistry &) = delete;
     ~FrameRegistry() {
-        for (auto &entry: list) {
-            delete entry;
+        for (auto &q : deferred) delete q;
+    }
+private:
+    static constexpr uint8_t NONE = 0xff;
+    /** type erased function or method */
+    struct Binding {
+        void *obj{};
+        alignas(void *) unsigned char fn[2 * sizeof(void *)]{};
+        void (*call)(const Binding &, Frame &){};
+        uint8_t next{NONE};
+    };
+    Binding table[MAX];
+    size_t used{};
+    /** first subscription per id */
+    uint8_t first[64];
+    Queue<Frame> *deferred[64]{};
+    Binding &add(uint8_t id) {
+        assert(id < 64 && used < MAX);
+        Binding &b = table[used];
+        uint8_t *link = &first[id];
+        while (*link != NONE) link = &table[*link].next;
+        *link = used++;
+        return b;
+    }
+    void call(Frame &f) {
+        for (uint8_t i = first[f.id]; i != NONE; i = table[i].next) {
+            f.rewind();
+            table[i].call(table[i], f);
         }
     }
 };
@@ -5,49 +5,148 @@
 #pragma once
 
 #include <utils/queue.h>
+#include <utils/slice.h>
 
 /** simple example of a pipe that receives bytes as they come in and splits them
  * into `\n` delimited lines.
  * also filters the newline out (both LF and CRLF style newlines)
+ *
+ * lines longer than the configured maximum length are dropped as a whole,
+ * and counted in `overlong`
  */
 class LineFilter : public Source<Buffer<uint8_t>> {
-    static constexpr size_t linelen = 128;
-    Queue<Buffer<uint8_t>> q;
-    Buffer<uint8_t> l = linelen; // stash
-    Source<Buffer<uint8_t>> &source;
-    void recv(uint8_t b) {
-        // handle both \n and \r\n newlines
-        if (b == '\n' || b == '\r') {
-            if (l.len == 0) return;
-            q.trypush(std::move(l));
-            l = linelen;
-            return;
+public:
+    /** line splitting stage, for use in static pipes (see pipe.h)
+     *
+     * passes lines on as Slice, which is only valid during the call to
+     * `next`. Lines fully contained in an input Buffer are handed out as
+     * view into it, only lines spanning Buffers are copied together.
+     */
+    struct Stage {
+        /** maximum length of line */
+        const size_t linelen;
+        /** number of dropped lines that were longer than `linelen` */
+        size_t overlong{};
+        Stage(size_t linelen=128) : linelen(linelen), l(linelen) { }
+        /** split incoming bytes into lines, pass them on to `next` */
+        template<typename Next>
+        void operator()(Buffer<uint8_t> &&in, Next &&next) {
+            const uint8_t *p = in.buf, *end = in.buf + in.len;
+            while (p < end) {
+                const uint8_t *nl = find(p, end);
+                size_t n = nl - p;
+                if (l.len == 0 && !skip && nl != end) {
+                    // line fully contained in input
+                    if (n > linelen) {
+                        overlong++;
+                    } else if (n) {
+                        next(Slice<uint8_t>{in, (size_t)(p - in.buf), (size_t)(nl - in.buf)});
+                    }
+                } else {
+                    // line spans input Buffers
+                    if (!skip && l.len + n > linelen) {
+                        overlong++;
+                        skip = true;
+                    }
+                    if (!skip) {
+                        memcpy(l.buf + l.len, p, n);
+                        l.len += n;
+                    }
+                    if (nl != end) {
+                        if (l.len && !skip) next(Slice<uint8_t>{l, 0, l.len});
+                        l.len = 0;
+                        skip = false;
+                    }
+                }
+                p = nl != end ? nl + 1 : end;
+            }
         }
-        if (l.len + 1 > linelen) {
-            // XXX: failure: line was longer than our buffer
-            // Drop Line
-            l = linelen;
+        /** check whether `in` holds exactly one line, and no other line
+         * is pending. If so, strip the trailing newline.
+         *
+         * allows handing out the input Buffer as is
+         */
+        bool whole(Buffer<uint8_t> &in) {
+            if (l.len || skip) return false;
+            const uint8_t *end = in.buf + in.len;
+            const uint8_t *nl = find(in.buf, end);
+            size_t n = nl - in.buf;
+            if (n == 0 || n > linelen || nl == end) return false;
+            for (auto p = nl; p != end; ++p) {
+                if (*p != '\n' && *p != '\r') return false;
+            }
+            in.len = n;
+            return true;
         }
-        l.append(b);
-    }
+        /** find first `\n` or `\r` in [p, end), return end if none
+         *
+         * checks a whole word at a time for either of them
+         */
+        static const uint8_t *find(const uint8_t *p, const uint8_t *end) {
+            constexpr size_t ones = (size_t)-1 / 0xff;
+            constexpr size_t highs = ones * 0x80;
+            auto haszero = [](size_t v) { return (v - ones) & ~v & highs; };
+            while (p + sizeof(size_t) <= end) {
+                size_t w;
+                memcpy(&w, p, sizeof w);
+                if (haszero(w ^ (ones * '\n')) || haszero(w ^ (ones * '\r'))) break;
+                p += sizeof w;
+            }
+            for (; p != end; ++p) {
+                if (*p == '\n' || *p == '\r') return p;
+            }
+            return end;
+        }
+    private:
+        Buffer<uint8_t> l; // stash for lines spanning input Buffers
+        bool skip{}; // dropping rest of overlong line
+    };
+private:
+    Queue<Buffer<uint8_t>> q;
+    Stage stage;
+    Source<Buffer<uint8_t>> &source;
 public:
-    /** set underlying Source */
-    LineFilter(Source<Buffer<uint8_t>> &p): source(p) { }
+    /** set underlying Source and maximum line length */
+    LineFilter(Source<Buffer<uint8_t>> &p, size_t linelen=128)
+        : stage(linelen), source(p) { }
+    /** number of dropped lines that were longer than the maximum */
+    const size_t &overlong{stage.overlong};
     bool empty() override {
+        auto enqueue = [this](Slice<uint8_t> &&l) {
+            Buffer<uint8_t> b = l.len;
+            memcpy(b.buf, l.begin(), l.len);
+            b.len = l.len;
+            q.trypush(std::move(b));
+        };
         while (!q.full() && !source.empty()) {
-            for (auto b: source.pop()) {
-                recv(b);
+            auto in = source.pop();
+            if (stage.whole(in)) {
+                q.trypush(std::move(in));
+            } else {
+                stage(std::move(in), enqueue);
             }
         }
         return q.empty();
     }
     Buffer<uint8_t> pop() override { return q.pop(); }
+    size_t popBatch(Buffer<uint8_t> *out, size_t max) override {
+        if (LineFilter::empty()) return 0;
+        return q.popBatch(out, max);
+    }
+    void notify(Signal &s) override { source.notify(s); }
 };
 
 /** simple pipe that will append a newline to every data packet */
 class LineDelimiter : public Sink<Buffer<uint8_t>> {
     Sink<Buffer<uint8_t>> &p;
 public:
+    /** newline appending stage, for use in static pipes (see pipe.h) */
+    struct Stage {
+        template<typename Next>
+        void operator()(Buffer<uint8_t> &&b, Next &&next) {
+            next(delimit(std::move(b)));
+        }
+    };
     /** set underlying Sink */
     LineDelimiter(Sink<Buffer<uint8_t>> &p): p(p) { }
     bool full() override {
@@ -61,10 +160,19 @@ public:
         }
     }
     void push(Buffer<uint8_t> &&b) override {
+        p.push(delimit(std::move(b)));
+    }
+    size_t pushBatch(Buffer<uint8_t> *b, size_t n) override {
+        for (size_t i = 0; i < n; ++i) b[i] = delimit(std::move(b[i]));
+        size_t taken = p.pushBatch(b, n);
+        // Buffers not taken are pushed again later, drop their newline
+        for (size_t i = taken; i < n; ++i) b[i].len--;
+        return taken;
+    }
+    static Buffer<uint8_t> delimit(Buffer<uint8_t> &&b) {
         if (b.len + 1 <= b.size) {
-            p.push(std::move(b.append('\n')));
-        } else {
-            p.push(std::move(Buffer<uint8_t>{b.buf, b.size, b.size+1}.append('\n')));
+            return std::move(b.append('\n'));
         }
+        return std::move(Buffer<uint8_t>{b.buf, b.size, b.size+1}.append('\n'));
     }
 };
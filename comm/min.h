@@ -3,33 +3,12 @@
  * Copyright (c) 2023 IACE
  */
 #pragma once
+#include "crc.h"
 #include "frameregistry.h"
 
 #include <stdint.h>
 #include <utils/queue.h>
 
-/** simple CRC32 implementation */
-struct CRC32 {
-    /** state */
-    uint32_t checksum{0xffffffff};
-    /** reinitialize state */
-    void init() {
-        *this = CRC32{};
-    }
-    /** calculate step with given byte */
-    void step(uint8_t byte) {
-        checksum ^= byte;
-        for (uint32_t j = 0; j < 8; j++) {
-            uint32_t mask = (uint32_t) -(checksum & 1U);
-            checksum = (checksum >> 1) ^ (0xedb88320U & mask);
-        }
-    }
-    /** get final CRC32 value */
-    uint32_t finalize() {
-        return ~checksum;
-    }
-};
-
 /** full min-based connection wrapper */
 struct Min {
     // Special protocol bytes
@@ -38,6 +17,24 @@ struct Min {
         STUFF_BYTE = 0x55U,
         EOF_BYTE = 0x55U,
     };
+    /** Frame ids with this bit set carry a sequence number */
+    static constexpr uint8_t TRANSPORT = 0x80U;
+    /** framing of Frames in the underlying Buffer stream
+     *
+     * both sides of a connection must use the same framing
+     */
+    enum Framing : uint8_t {
+        /** header bytes, byte stuffing, CRC32, for byte streams (UART) */
+        STREAM,
+        /** `[id][seq][len] payload` back to back, one or more Frames per
+         * Buffer, for packet transports preserving boundaries and integrity
+         * (UDP). `seq` is only present for transport Frames */
+        DATAGRAM,
+        /** COBS encoded `[id][seq] payload [CRC32]`, each followed by a zero
+         * byte, for byte streams with bounded overhead (1 byte per 254) */
+        COBS,
+    };
+    struct Transport;
     /** incoming Min stream
      *
      * check data availability from underlying Buffer stream with
@@ -61,120 +58,276 @@ struct Min {
      * \enddot
      **/
     class In : public Source<Frame> {
-        CRC32 crc{};
-        Frame frame{};
-        Queue<Frame> queue{20};
-        Source<Buffer<uint8_t>> &source;
-        uint8_t header_seen{0}, frame_length{0};
-        uint32_t frame_crc{0};
-        // Receiving state machine
-        enum State {
-            SEARCHING_FOR_SOF,
-            RECEIVING_ID_CONTROL,
-            RECEIVING_SEQ,
-            RECEIVING_LENGTH,
-            RECEIVING_PAYLOAD,
-            RECEIVING_CHECKSUM_3,
-            RECEIVING_CHECKSUM_2,
-            RECEIVING_CHECKSUM_1,
-            RECEIVING_CHECKSUM_0,
-            RECEIVING_EOF,
-        } state {};
-        void byte(uint8_t b) {
-            // three header bytes always mean "start of frame" and will
-            // reset the frame buffer and be ready to receive frame data
-            //
-            // two in a row during the frame means to expect a stuff byte.
-
-            if (header_seen == 2) {
-                header_seen = 0;
-                if (b == HEADER_BYTE) {
-                    state = RECEIVING_ID_CONTROL;
-                    return;
+    public:
+        /** Min decoding stage, for use in static pipes (see pipe.h) */
+        struct Stage {
+            Stage(Framing framing=STREAM) {
+                setFraming(framing);
+            }
+            /** change framing of incoming Buffers */
+            void setFraming(Framing f) {
+                framing = f;
+                if (f == COBS && raw.size == 0) raw = Buffer<uint8_t>(RAWLEN);
+            }
+            /** decode incoming bytes, pass received Frames on to `next`
+             *
+             * runs between header bytes, i.e. garbage while searching for
+             * the start of a Frame and most of the payload, are skipped or
+             * copied in bulk. Only header bytes and their surroundings go
+             * through the byte state machine.
+             */
+            template<typename Next>
+            void operator()(Buffer<uint8_t> &&in, Next &&next) {
+                if (framing == DATAGRAM) return datagram(in, next);
+                if (framing == COBS) return cobs(in, next);
+                const uint8_t *p = in.buf, *end = in.buf + in.len;
+                while (p < end) {
+                    if (header_seen == 0) {
+                        size_t n = end - p;
+                        if (state == RECEIVING_PAYLOAD && frame_length < n) {
+                            n = frame_length;
+                        }
+                        const uint8_t *h = n ? (const uint8_t *)
+                                memchr(p, HEADER_BYTE, n) : p;
+                        size_t run = h ? h - p : n;
+                        if (state == SEARCHING_FOR_SOF) {
+                            if (!h) break;
+                            p = h;
+                        } else if (state == RECEIVING_PAYLOAD && run) {
+                            memcpy(frame.b.buf + frame.b.len, p, run);
+                            frame.b.len += run;
+                            frame_length -= run;
+                            p += run;
+                            if (frame_length == 0) state = RECEIVING_CHECKSUM_3;
+                            continue;
+                        }
+                    }
+                    if (byte(*p++)) {
+                        next(std::move(frame));
+                        frame = {};
+                    }
                 }
-                if (b == STUFF_BYTE) {
-                    // discard this byte
-                    return;
-                } else {
-                    // something has gone wrong, give up
-                    state = SEARCHING_FOR_SOF;
-                    return;
+            }
+        private:
+            Framing framing{};
+            CRC32 crc{};
+            Frame frame{};
+            uint8_t header_seen{0}, frame_length{0};
+            /** longest decoded COBS Frame: id, seq, payload, CRC32 */
+            static constexpr size_t RAWLEN = 2 + 255 + 4;
+            /** decoded bytes of current COBS Frame */
+            Buffer<uint8_t> raw{};
+            /** COBS block code and bytes left in block */
+            uint8_t code{}, left{};
+            bool started{}, broken{};
+            /** split Buffer into back to back Frames */
+            template<typename Next>
+            void datagram(const Buffer<uint8_t> &in, Next &next) {
+                const uint8_t *p = in.buf, *end = in.buf + in.len;
+                while (end - p >= 2) {
+                    Frame f{*p++};
+                    if (f.id & TRANSPORT) f.seq = *p++;
+                    else f.id &= 0x3fU;
+                    if (p == end) return;
+                    uint8_t len = *p++;
+                    if (end - p < len) return;
+                    if (len > f.b.size) f.b = Buffer<uint8_t>(len);
+                    memcpy(f.b.buf, p, len);
+                    f.b.len = len;
+                    p += len;
+                    next(std::move(f));
                 }
             }
-
-            if (b == HEADER_BYTE) {
-                header_seen++;
-            } else {
-                header_seen = 0;
+            /** decode COBS stream, runs of data are copied in bulk */
+            template<typename Next>
+            void cobs(const Buffer<uint8_t> &in, Next &next) {
+                const uint8_t *p = in.buf, *end = in.buf + in.len;
+                while (p < end) {
+                    if (*p == 0) {
+                        p++;
+                        if (!broken && left == 0) cobsFrame(next);
+                        raw.len = 0;
+                        left = 0;
+                        started = broken = false;
+                        continue;
+                    }
+                    if (left == 0) {
+                        if (started && code < 0xff) {
+                            if (raw.len == raw.size) broken = true;
+                            else raw.buf[raw.len++] = 0;
+                        }
+                        started = true;
+                        code = *p++;
+                        left = code - 1;
+                        continue;
+                    }
+                    size_t n = end - p < left ? end - p : left;
+                    auto z = (const uint8_t *)memchr(p, 0, n);
+                    size_t run = z ? z - p : n;
+                    if (raw.size - raw.len < run) {
+                        broken = true;
+                    } else {
+                        memcpy(raw.buf + raw.len, p, run);
+                        raw.len += run;
+                    }
+                    left -= run;
+                    p += run;
+                }
+            }
+            /** check and hand on decoded COBS Frame */
+            template<typename Next>
+            void cobsFrame(Next &next) {
+                const uint8_t *p = raw.buf;
+                size_t head = raw.len && raw.buf[0] & TRANSPORT ? 2 : 1;
+                if (raw.len < head + 4) return;
+                size_t len = raw.len - head - 4;
+                if (len > 255) return;
+                crc.init();
+                crc.update(p, raw.len - 4);
+                const uint8_t *c = raw.buf + raw.len - 4;
+                uint32_t sum = (uint32_t) c[0] << 24 | (uint32_t) c[1] << 16
+                    | (uint32_t) c[2] << 8 | c[3];
+                if (sum != crc.finalize()) return;
+                Frame f{head == 2 ? p[0] : (uint8_t) (p[0] & 0x3fU)};
+                if (head == 2) f.seq = p[1];
+                if (len > f.b.size) f.b = Buffer<uint8_t>(len);
+                memcpy(f.b.buf, p + head, len);
+                f.b.len = len;
+                next(std::move(f));
             }
+            uint32_t frame_crc{0};
+            // Receiving state machine
+            enum State {
+                SEARCHING_FOR_SOF,
+                RECEIVING_ID_CONTROL,
+                RECEIVING_SEQ,
+                RECEIVING_LENGTH,
+                RECEIVING_PAYLOAD,
+                RECEIVING_CHECKSUM_3,
+                RECEIVING_CHECKSUM_2,
+                RECEIVING_CHECKSUM_1,
+                RECEIVING_CHECKSUM_0,
+                RECEIVING_EOF,
+            } state {};
+            /** feed single byte, return true once a valid Frame is complete */
+            bool byte(uint8_t b) {
+                // three header bytes always mean "start of frame" and will
+                // reset the frame buffer and be ready to receive frame data
+                //
+                // two in a row during the frame means to expect a stuff byte.
 
-            switch (state) {
-                case SEARCHING_FOR_SOF:
-                    // handled at the header byte site
-                    break;
-                case RECEIVING_ID_CONTROL:
-                    frame.id = b & (uint8_t) 0x3fU;
-                    frame.b.len = 0;
-                    crc.init();
-                    crc.step(b);
-                    state = RECEIVING_LENGTH;
-                    break;
-                case RECEIVING_LENGTH:
-                    frame_length = b;
-                    crc.step(b);
-                    if (frame_length > 0) {
-                        state = RECEIVING_PAYLOAD;
-                    } else {
-                        state = RECEIVING_CHECKSUM_3;
+                if (header_seen == 2) {
+                    header_seen = 0;
+                    if (b == HEADER_BYTE) {
+                        state = RECEIVING_ID_CONTROL;
+                        return false;
                     }
-                    break;
-                case RECEIVING_PAYLOAD:
-                    frame.b.append(b);
-                    crc.step(b);
-                    if (--frame_length == 0) {
-                        state = RECEIVING_CHECKSUM_3;
+                    if (b == STUFF_BYTE) {
+                        // discard this byte
+                        return false;
+                    } else {
+                        // something has gone wrong, give up
+                        state = SEARCHING_FOR_SOF;
+                        return false;
                     }
-                    break;
-                case RECEIVING_CHECKSUM_3:
-                    frame_crc = ((uint32_t) b) << 24;
-                    state = RECEIVING_CHECKSUM_2;
-                    break;
-                case RECEIVING_CHECKSUM_2:
-                    frame_crc |= ((uint32_t) b) << 16;
-                    state = RECEIVING_CHECKSUM_1;
-                    break;
-                case RECEIVING_CHECKSUM_1:
-                    frame_crc |= ((uint32_t) b) << 8;
-                    state = RECEIVING_CHECKSUM_0;
-                    break;
-                case RECEIVING_CHECKSUM_0:
-                    frame_crc |= b;
-                    if (frame_crc == crc.finalize()) {
+                }
+
+                if (b == HEADER_BYTE) {
+                    header_seen++;
+                } else {
+                    header_seen = 0;
+                }
+
+                switch (state) {
+                    case SEARCHING_FOR_SOF:
+                        // handled at the header byte site
+                        break;
+                    case RECEIVING_ID_CONTROL:
+                        // transport Frames keep their full id
+                        frame.id = b & TRANSPORT ? b : b & (uint8_t) 0x3fU;
+                        frame.b.len = 0;
+                        crc.init();
+                        crc.step(b);
+                        state = b & TRANSPORT ? RECEIVING_SEQ : RECEIVING_LENGTH;
+                        break;
+                    case RECEIVING_SEQ:
+                        frame.seq = b;
+                        crc.step(b);
+                        state = RECEIVING_LENGTH;
+                        break;
+                    case RECEIVING_LENGTH:
+                        frame_length = b;
+                        crc.step(b);
+                        if (frame_length > frame.b.size) {
+                            frame.b = Buffer<uint8_t>(frame_length);
+                        }
+                        if (frame_length > 0) {
+                            state = RECEIVING_PAYLOAD;
+                        } else {
+                            state = RECEIVING_CHECKSUM_3;
+                        }
+                        break;
+                    case RECEIVING_PAYLOAD:
+                        frame.b.append(b);
+                        if (--frame_length == 0) {
+                            state = RECEIVING_CHECKSUM_3;
+                        }
+                        break;
+                    case RECEIVING_CHECKSUM_3:
+                        frame_crc = ((uint32_t) b) << 24;
+                        state = RECEIVING_CHECKSUM_2;
+                        break;
+                    case RECEIVING_CHECKSUM_2:
+                        frame_crc |= ((uint32_t) b) << 16;
+                        state = RECEIVING_CHECKSUM_1;
+                        break;
+                    case RECEIVING_CHECKSUM_1:
+                        frame_crc |= ((uint32_t) b) << 8;
+                        state = RECEIVING_CHECKSUM_0;
+                        break;
+                    case RECEIVING_CHECKSUM_0:
+                        frame_crc |= b;
+                        crc.update(frame.b.buf, frame.b.len);
+                        // Either the frame failed, or we are handing it up
+                        // anyway we can start looking for the next frame,
+                        // we don't have to explicitly wait for the EOF
+                        state = SEARCHING_FOR_SOF;
                         // Frame received OK, pass up data to handler
-                        queue.trypush(std::move(frame));
-                        frame = {};
-                    }
-                    // Either the frame failed, or we already handled it
-                    // anyway we can start looking for the next frame,
-                    // we don't have to explicitly wait for the EOF
-                    state = SEARCHING_FOR_SOF;
-                    break;
-                case RECEIVING_EOF:
-                    // fallthrough
-                default:
-                    state = SEARCHING_FOR_SOF;
-                    break;
+                        return frame_crc == crc.finalize();
+                    case RECEIVING_EOF:
+                        // fallthrough
+                    default:
+                        state = SEARCHING_FOR_SOF;
+                        break;
+                }
+                return false;
             }
-        }
+        };
+    private:
+        Queue<Frame> queue{20};
+        Source<Buffer<uint8_t>> &source;
+        Stage stage;
     public:
         /** unwrap given Buffer stream into Frame */
         In(Source<Buffer<uint8_t>> &from) : source{from} { }
+        /** change framing of incoming Buffers, see Min::Framing */
+        void framing(Framing f) {
+            stage.setFraming(f);
+        }
+        /** reliable transport handling transport Frames, dropped if unset */
+        Transport *transport{};
         /** check if Frame available */
         bool empty() override {
-            while (!queue.full() && !source.empty()) {
-                for (auto b: source.pop()) {
-                    byte(b);
+            auto enqueue = [this](Frame &&f) {
+                bool room = !queue.full();
+                if (f.id & TRANSPORT
+                        && !(transport && transport->accept(f, room))) {
+                    return;
                 }
+                if (room) queue.push(std::move(f));
+            };
+            while (!queue.full() && !source.empty()) {
+                stage(source.pop(), enqueue);
             }
             return queue.empty();
         }
@@ -186,6 +339,15 @@ struct Min {
         Frame pop() override {
             return queue.pop();
         }
+        /** get up to `max` available Frames at once */
+        size_t popBatch(Frame *out, size_t max) override {
+            if (In::empty()) return 0;
+            return queue.popBatch(out, max);
+        }
+        /** Frames become available with data in the underlying stream */
+        void notify(Signal &s) override {
+            source.notify(s);
+        }
         void *operator new(size_t sz, In *where) {
             return where;
         }
@@ -206,57 +368,448 @@ struct Min {
      * \enddot
      **/
     class Out : public Sink<Frame> {
-        CRC32 crc{};
-        Buffer<uint8_t> req = 128;
-        Sink<Buffer<uint8_t>> &out;
-        uint8_t header_countdown = 2;
-        void stuff(uint8_t b) {
-            req.append(b);
-            crc.step(b);
+    public:
+        /** worst case length of an encoded Frame with `len` bytes payload
+         *
+         * header, stuffed id, sequence, length, payload & checksum, EOF.
+         * Also bounds the DATAGRAM and COBS framings.
+         */
+        static constexpr size_t bound(size_t len) {
+            return 3 + (len + 7) + (len + 7) / 2 + 1;
+        }
+        /** Min encoding stage, for use in static pipes (see pipe.h) */
+        struct Stage {
+            Stage(Framing framing=STREAM) : framing(framing) { }
+            /** change framing of outgoing Buffers */
+            void setFraming(Framing f) {
+                framing = f;
+            }
+            /** encode Frame, pass resulting Buffer on to `next` */
+            template<typename Next>
+            void operator()(Frame &&f, Next &&next) {
+                Buffer<uint8_t> req = bound(f.b.len);
+                encode(req, f);
+                next(std::move(req));
+            }
+            /** append encoded Frame to given Buffer
+             *
+             * the Buffer must have room for `bound(f.b.len)` more bytes.
+             * runs of payload without header bytes are copied in bulk.
+             */
+            void encode(Buffer<uint8_t> &req, const Frame &f) {
+                assert(req.size - req.len >= bound(f.b.len));
+                if (framing == DATAGRAM) return datagram(req, f);
+                if (framing == COBS) return cobs(req, f);
+                crc.init();
+                crc.step(f.id);
+                if (f.id & TRANSPORT) crc.step(f.seq);
+                crc.step(f.b.len);
+                crc.update(f.b.buf, f.b.len);
+                uint8_t *o = req.buf + req.len;
+                *o++ = HEADER_BYTE;
+                *o++ = HEADER_BYTE;
+                *o++ = HEADER_BYTE;
+                header_countdown = 2;
+                o = stuff(o, f.id);
+                if (f.id & TRANSPORT) o = stuff(o, f.seq);
+                o = stuff(o, f.b.len);
+                const uint8_t *p = f.b.buf, *end = f.b.buf + f.b.len;
+                while (p < end) {
+                    auto h = (const uint8_t *)memchr(p, HEADER_BYTE, end - p);
+                    size_t run = (h ? h : end) - p;
+                    if (run) {
+                        memcpy(o, p, run);
+                        o += run;
+                        p += run;
+                        header_countdown = 2;
+                    }
+                    if (p < end) o = stuff(o, *p++);
+                }
+                uint32_t sum = crc.finalize();
+                o = stuff(o, (uint8_t) ((sum >> 24) & 0xff));
+                o = stuff(o, (uint8_t) ((sum >> 16) & 0xff));
+                o = stuff(o, (uint8_t) ((sum >> 8) & 0xff));
+                o = stuff(o, (uint8_t) ((sum >> 0) & 0xff));
+                *o++ = EOF_BYTE;
+                req.len = o - req.buf;
+            }
+        private:
+            Framing framing{};
+            CRC32 crc{};
+            uint8_t header_countdown = 2;
+            void datagram(Buffer<uint8_t> &req, const Frame &f) {
+                uint8_t *o = req.buf + req.len;
+                *o++ = f.id;
+                if (f.id & TRANSPORT) *o++ = f.seq;
+                *o++ = f.b.len;
+                memcpy(o, f.b.buf, f.b.len);
+                req.len = o + f.b.len - req.buf;
+            }
+            /** COBS encoder writing into a Buffer */
+            struct Cobs {
+                uint8_t *o, *code;
+                uint8_t n{1};
+                Cobs(uint8_t *o) : o(o + 1), code(o) { }
+                void block() {
+                    *code = n;
+                    code = o++;
+                    n = 1;
+                }
+                /** encode bytes, runs without zeros are copied in bulk */
+                void write(const uint8_t *p, size_t len) {
+                    while (len) {
+                        size_t room = 0xff - n;
+                        size_t m = len < room ? len : room;
+                        auto z = (const uint8_t *)memchr(p, 0, m);
+                        size_t run = z ? z - p : m;
+                        memcpy(o, p, run);
+                        o += run;
+                        n += run;
+                        p += run;
+                        len -= run;
+                        if (z) {
+                            block();
+                            p++;
+                            len--;
+                        } else if (n == 0xff) {
+                            block();
+                        }
+                    }
+                }
+            };
+            void cobs(Buffer<uint8_t> &req, const Frame &f) {
+                uint8_t head[2] = {f.id, f.seq};
+                size_t hl = f.id & TRANSPORT ? 2 : 1;
+                crc.init();
+                crc.update(head, hl);
+                crc.update(f.b.buf, f.b.len);
+                uint32_t sum = crc.finalize();
+                uint8_t tail[4] = {
+                    (uint8_t) (sum >> 24), (uint8_t) (sum >> 16),
+                    (uint8_t) (sum >> 8), (uint8_t) sum,
+                };
+                Cobs c{req.buf + req.len};
+                c.write(head, hl);
+                c.write(f.b.buf, f.b.len);
+                c.write(tail, 4);
+                *c.code = c.n;
+                *c.o++ = 0;
+                req.len = c.o - req.buf;
+            }
+            uint8_t *stuff(uint8_t *o, uint8_t b) {
+                *o++ = b;
 
-            // See if an additional stuff byte is needed
-            if (b == HEADER_BYTE) {
-                if (--header_countdown == 0) {
-                    req.append(STUFF_BYTE);
+                // See if an additional stuff byte is needed
+                if (b == HEADER_BYTE) {
+                    if (--header_countdown == 0) {
+                        *o++ = STUFF_BYTE;
+                        header_countdown = 2U;
+                    }
+                } else {
                     header_countdown = 2U;
                 }
-            } else {
-                header_countdown = 2U;
+                return o;
             }
+        };
+    private:
+        Sink<Buffer<uint8_t>> &out;
+        Stage stage;
+        Buffer<uint8_t> pending{};
+    public:
+        /** priority lanes, see `shape` */
+        enum Priority : uint8_t {
+            CONTROL,
+            NORMAL,
+            BULK,
+            LANES,
+        };
+        /** bytes collected before pushing to the underlying stream, 0 pushes
+         * every Frame on its own */
+        const size_t batch;
+        /** number of Frames dropped for a full lane, see `shape` */
+        size_t dropped{};
+        /** create Buffer stream wrapper
+         *
+         * with `batch` set, Frames are encoded into a shared Buffer of that
+         * size, which is pushed out once full, or on `flush`. Call `flush`
+         * once per tick, e.g. through `Min::poll`
+         */
+        Out(Sink<Buffer<uint8_t>> &to, size_t batch=0) : out{to}, batch{batch} { }
+        /** change framing of outgoing Buffers, see Min::Framing */
+        void framing(Framing f) {
+            flush();
+            stage.setFraming(f);
         }
-        void nostuff(uint8_t b) {
-            req.append(b);
+        Out(const Out &) = delete;
+        Out &operator=(const Out &) = delete;
+        ~Out() {
+            for (auto &l : lanes) delete l;
+        }
+        /** send Frames through priority lanes, limited to the link rate
+         *
+         * Frames are queued in one lane per priority, `depth` Frames each,
+         * and sent in `poll`: CONTROL first, then NORMAL, BULK fills the
+         * remaining bandwidth. A token bucket gains `rate` bytes per second
+         * up to `burst` bytes, each encoded Frame takes its length, so the
+         * underlying stream never gets more than the link can carry. For a
+         * UART with 8N1 framing, `rate` is the baud rate / 10.
+         *
+         * Frames go to NORMAL, unless their id is assigned another lane with
+         * `priority`. Transport acknowledgements go to CONTROL. `full()`
+         * reports the NORMAL lane, Frames pushed to any other full lane are
+         * dropped and counted in `dropped`, so a saturated BULK lane never
+         * holds back CONTROL or NORMAL Frames. Use `full(id)` to check the
+         * lane of a given id.
+         */
+        void shape(uint32_t rate, size_t depth=16, size_t burst=0) {
+            assert(rate && !this->rate);
+            this->rate = rate;
+            this->burst = burst ? burst : bound(255) + rate / 100;
+            tokens = this->burst;
+            for (auto &l : lanes) l = new Queue<Frame>(depth);
+            lane = Buffer<uint8_t>(256);
+            lane.len = lane.size;
+            for (auto &l : lane) l = NORMAL;
+            lane[0xff] = lane[0xfe] = CONTROL;
+        }
+        /** send Frames with given id through lane `p`, see `shape` */
+        void priority(uint8_t id, Priority p) {
+            assert(rate && p < LANES);
+            lane[id] = p;
         }
-    public:
-        /** create Buffer stream wrapper */
-        Out(Sink<Buffer<uint8_t>> &to) : out{to} { }
         using Sink<Frame>::push;
+        /** true if the NORMAL lane is full, see `shape` */
         bool full() override {
+            if (rate) return lanes[NORMAL]->full();
+            return out.full();
+        }
+        /** true if a Frame with given id would not fit into its lane */
+        bool full(uint8_t id) {
+            if (rate) return lanes[lane[id]]->full();
             return out.full();
         }
         /** push Frame through to underlying Buffer stream */
         void push(Frame &&f) override {
-            req = 128;
-            crc.init();
-            nostuff(HEADER_BYTE);
-            nostuff(HEADER_BYTE);
-            nostuff(HEADER_BYTE);
-            stuff(f.id);
-            stuff(f.b.len);
-            for (size_t i = 0; i < f.b.len; ++i) {
-                stuff(f.b.at(i));
+            if (!rate) {
+                send(std::move(f));
+                return;
+            }
+            auto &l = *lanes[lane[f.id]];
+            if (l.full()) {
+                dropped++;
+                return;
+            }
+            l.push(std::move(f));
+        }
+        /** push Frames through to underlying stream as single Buffer */
+        size_t pushBatch(Frame *f, size_t n) override {
+            if (rate) {
+                size_t i = 0;
+                while (i < n && !full(f[i].id)) push(std::move(f[i++]));
+                return i;
+            }
+            if (n == 0 || out.full()) return 0;
+            if (batch) {
+                for (size_t i = 0; i < n; ++i) push(std::move(f[i]));
+                return n;
             }
-            uint32_t sum = crc.finalize();
-            stuff((uint8_t) ((sum >> 24) & 0xff));
-            stuff((uint8_t) ((sum >> 16) & 0xff));
-            stuff((uint8_t) ((sum >> 8) & 0xff));
-            stuff((uint8_t) ((sum >> 0) & 0xff));
-            nostuff(EOF_BYTE);
-            out.trypush(std::move(req));
+            size_t sz = 0;
+            for (size_t i = 0; i < n; ++i) sz += bound(f[i].b.len);
+            Buffer<uint8_t> req = sz;
+            for (size_t i = 0; i < n; ++i) stage.encode(req, f[i]);
+            out.push(std::move(req));
+            return n;
+        }
+        /** push out collected Frames */
+        void flush() {
+            if (!pending.len) return;
+            out.trypush(std::move(pending));
+            pending.len = 0;
+        }
+        /** send queued Frames as far as the link rate allows, then flush
+         *
+         * signature fits for recurring calls, see Schedule::Recurring
+         */
+        void poll(uint32_t, uint32_t dt) {
+            if (rate) {
+                credit += rate * dt;
+                tokens += credit / 1000;
+                credit %= 1000;
+                if (tokens > (int32_t)burst) tokens = burst;
+                for (auto l : lanes) {
+                    while (tokens > 0 && !l->empty() && !out.full()) {
+                        tokens -= send(l->pop());
+                    }
+                }
+            }
+            flush();
         }
         void *operator new(size_t sz, Out *where) {
             return where;
         }
+    private:
+        /** link rate in bytes/s, 0 if not shaped */
+        uint32_t rate{};
+        size_t burst{};
+        int32_t tokens{};
+        uint32_t credit{};
+        Queue<Frame> *lanes[LANES]{};
+        /** lane per Frame id */
+        Buffer<uint8_t> lane{};
+        /** encode Frame, return number of bytes sent */
+        size_t send(Frame &&f) {
+            if (!batch) {
+                size_t len{};
+                stage(std::move(f), [&](Buffer<uint8_t> &&req) {
+                    len = req.len;
+                    out.trypush(std::move(req));
+                });
+                return len;
+            }
+            size_t need = bound(f.b.len);
+            if (pending.size - pending.len < need) {
+                flush();
+                pending = Buffer<uint8_t>(need > batch ? need : batch);
+            }
+            size_t before = pending.len;
+            stage.encode(pending, f);
+            return pending.len - before;
+        }
+    };
+    /** reliable transport layer
+     *
+     * Frames pushed into the Transport are sent with sequence numbers and
+     * kept until the other side acknowledges them. Up to `window` Frames are
+     * in flight, unacknowledged Frames are all resent `timeout` ms after the
+     * last progress (go-back-N).
+     * Received transport Frames are handed on in order through `Min::in`,
+     * out of order Frames are dropped. Acknowledgements are coalesced and
+     * sent once per `poll`, which must be called recurringly:
+     * ```
+     *      Min min{.in=uart, .out=uart};
+     *      Min::Transport reliable{min};
+     *      k.every(1, min, &Min::poll);
+     *      k.every(1, reliable, &Min::Transport::poll);
+     *      ...
+     *      reliable.push(trajectory);
+     * ```
+     * on the wire, transport Frames have `TRANSPORT` set in their id,
+     * followed by the sequence number. ACK Frames carry the next expected
+     * sequence number, a RESET Frame resets the Transport on both sides.
+     */
+    struct Transport : Sink<Frame> {
+        /** control Frame ids */
+        enum : uint8_t {
+            ACK = 0xffU,
+            RESET = 0xfeU,
+        };
+        /** maximum number of unacknowledged Frames */
+        const size_t window;
+        /** retransmission timeout in ms */
+        const uint32_t timeout;
+        /** number of retransmitted Frames */
+        size_t resent{};
+        /** attach reliable transport to Min connection */
+        Transport(Min &min, size_t window=8, uint32_t timeout=50, size_t backlog=32)
+            : window(window), timeout(timeout), min(min)
+            , tx(backlog), sent(window) {
+            assert(window < 128);
+            min.in.transport = this;
+        }
+        ~Transport() {
+            min.in.transport = nullptr;
+        }
+        bool full() override {
+            return tx.full();
+        }
+        using Sink<Frame>::push;
+        /** queue Frame for reliable transmission, send it if window allows */
+        void push(Frame &&f) override {
+            tx.push(std::move(f));
+            send();
+        }
+        /** send acknowledgements, retransmit on timeout, send queued Frames
+         *
+         * signature fits for recurring calls, see Schedule::Recurring
+         */
+        void poll(uint32_t time, uint32_t) {
+            now = time;
+            min.in.empty();
+            if (ackDue && !min.out.full(ACK)) {
+                Frame ack{ACK};
+                ack.seq = rn;
+                ack.pack<uint8_t>(rn);
+                min.out.push(std::move(ack));
+                ackDue = false;
+            }
+            if (sent.size() && now - lastProgress >= timeout) {
+                for (size_t i = 0; i < sent.size() && !min.out.full(); ++i) {
+                    min.out.push(sent.getAt(i));
+                    resent++;
+                }
+                lastProgress = now;
+            }
+            send();
+        }
+        /** drop all Frames in flight and tell the other side to do the same */
+        void reset() {
+            clear();
+            Frame r{RESET};
+            min.out.trypush(std::move(r));
+        }
+        /** handle received transport Frame, return true if it is to be
+         * passed on as regular Frame
+         *
+         * without `room` to pass it on, a data Frame is neither acknowledged
+         * nor counted as received, so the other side sends it again
+         */
+        bool accept(Frame &f, bool room=true) {
+            switch (f.id) {
+            case ACK: {
+                uint8_t acked = f.seq - snMin;
+                if (acked > sent.size()) return false;
+                for (uint8_t i = 0; i < acked; ++i) sent.drop();
+                snMin = f.seq;
+                if (acked) lastProgress = now;
+                send();
+                return false;
+            }
+            case RESET:
+                clear();
+                return false;
+            default:
+                if (!room) return false;
+                ackDue = true;
+                if (f.seq != rn) return false;
+                rn++;
+                f.id &= 0x3f;
+                return true;
+            }
+        }
+    private:
+        Min &min;
+        /** Frames waiting for a free window slot */
+        Queue<Frame> tx;
+        /** Frames in flight, oldest first */
+        Queue<Frame> sent;
+        uint8_t snMin{}, snMax{}, rn{};
+        bool ackDue{};
+        uint32_t now{}, lastProgress{};
+        void send() {
+            while (!tx.empty() && sent.size() < window && !min.out.full()) {
+                Frame f = tx.pop();
+                f.id |= TRANSPORT;
+                f.seq = snMax++;
+                if (sent.empty()) lastProgress = now;
+                min.out.push(Frame{f});
+                sent.push(std::move(f));
+            }
+        }
+        void clear() {
+            while (!sent.empty()) sent.drop();
+            snMin = snMax = rn = 0;
+            ackDue = false;
+        }
     };
     /** incoming Frame stream */
     In in;
@@ -264,10 +817,27 @@ struct Min {
     Out out;
     /** Frame registry for this connection */
     FrameRegistry reg;
-    /** dispatch incoming Frames through registry */
-    void poll(uint32_t, uint32_t) {
+    /** use given framing in both directions
+     *
+     * e.g. `min.framing(Min::DATAGRAM)` on UDP, with `Out` batching
+     * several Frames per datagram
+     */
+    void framing(Framing f) {
+        in.framing(f);
+        out.framing(f);
+    }
+    /** dispatch incoming Frames through registry, send outgoing Frames */
+    void poll(uint32_t time, uint32_t dt) {
         while (!in.empty()) {
             reg.handle(in.pop());
         }
+        out.poll(time, dt);
     };
+    /** dispatch incoming Frames through registry
+     *
+     * signature fits for evented calls, e.g. `k.onReady(min.in)`
+     */
+    void poll(uint32_t) {
+        poll(0, 0);
+    }
 };
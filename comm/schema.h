@@ -0,0 +1,146 @@
+/** @file schema.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include <cstdio>
+#include <tuple>
+#include <type_traits>
+
+#include "frameregistry.h"
+
+/** declare the wire layout of a struct once
+ *
+ * list the fields to be transferred with the SCHEMA macro inside the struct.
+ * They are packed in order without padding, like consecutive calls to
+ * `Frame::pack`, but with a single bounds check for the whole struct:
+ * ```
+ *      struct State {
+ *          double x, v;
+ *          uint32_t count;
+ *          bool on;
+ *          float gains[3];
+ *          SCHEMA(State, x, v, count, on, gains);
+ *      };
+ *      Frame f{10};
+ *      Schema::pack(f, state);
+ *      ...
+ *      State s;
+ *      if (Schema::unpack(f, s)) ...
+ * ```
+ * The layout can be sent to the host as descriptor Frame, see `describe`.
+ * Fields may be arithmetic types or arrays thereof.
+ */
+#define SCHEMA(Type, ...) \
+    static constexpr auto schemaFields() { \
+        using S = Type; \
+        return std::make_tuple(SCHEMA_CAT(SCHEMA_P, SCHEMA_COUNT(__VA_ARGS__))(__VA_ARGS__)); \
+    } \
+    static constexpr const char *schemaName() { return #Type; } \
+    static constexpr const char *schemaNames() { return #__VA_ARGS__; }
+
+/// @cond internal
+#define SCHEMA_CAT(a, b) SCHEMA_CAT_(a, b)
+#define SCHEMA_CAT_(a, b) a##b
+#define SCHEMA_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, \
+        _14, _15, _16, N, ...) N
+#define SCHEMA_COUNT(...) SCHEMA_N(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, \
+        9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define SCHEMA_P1(a) &S::a
+#define SCHEMA_P2(a, ...) &S::a, SCHEMA_P1(__VA_ARGS__)
+#define SCHEMA_P3(a, ...) &S::a, SCHEMA_P2(__VA_ARGS__)
+#define SCHEMA_P4(a, ...) &S::a, SCHEMA_P3(__VA_ARGS__)
+#define SCHEMA_P5(a, ...) &S::a, SCHEMA_P4(__VA_ARGS__)
+#define SCHEMA_P6(a, ...) &S::a, SCHEMA_P5(__VA_ARGS__)
+#define SCHEMA_P7(a, ...) &S::a, SCHEMA_P6(__VA_ARGS__)
+#define SCHEMA_P8(a, ...) &S::a, SCHEMA_P7(__VA_ARGS__)
+#define SCHEMA_P9(a, ...) &S::a, SCHEMA_P8(__VA_ARGS__)
+#define SCHEMA_P10(a, ...) &S::a, SCHEMA_P9(__VA_ARGS__)
+#define SCHEMA_P11(a, ...) &S::a, SCHEMA_P10(__VA_ARGS__)
+#define SCHEMA_P12(a, ...) &S::a, SCHEMA_P11(__VA_ARGS__)
+#define SCHEMA_P13(a, ...) &S::a, SCHEMA_P12(__VA_ARGS__)
+#define SCHEMA_P14(a, ...) &S::a, SCHEMA_P13(__VA_ARGS__)
+#define SCHEMA_P15(a, ...) &S::a, SCHEMA_P14(__VA_ARGS__)
+#define SCHEMA_P16(a, ...) &S::a, SCHEMA_P15(__VA_ARGS__)
+/// @endcond
+
+/** (un)packing of structs declared with SCHEMA */
+namespace Schema {
+/** format character of arithmetic type, as used by python's `struct` */
+template<typename T>
+constexpr char code() {
+    static_assert(std::is_arithmetic_v<T>, "unsupported field type");
+    if constexpr (std::is_same_v<T, bool>) return '?';
+    else if constexpr (std::is_same_v<T, float>) return 'f';
+    else if constexpr (std::is_same_v<T, double>) return 'd';
+    else if constexpr (sizeof(T) == 1) return std::is_signed_v<T> ? 'b' : 'B';
+    else if constexpr (sizeof(T) == 2) return std::is_signed_v<T> ? 'h' : 'H';
+    else if constexpr (sizeof(T) == 4) return std::is_signed_v<T> ? 'i' : 'I';
+    else return std::is_signed_v<T> ? 'q' : 'Q';
+}
+
+/** packed size of struct T on the wire */
+template<typename T>
+constexpr size_t size() {
+    return std::apply([](auto... m) {
+        return (sizeof(std::declval<T>().*m) + ... + 0);
+    }, T::schemaFields());
+}
+
+/** pack struct into Frame */
+template<typename T>
+Frame &pack(Frame &f, const T &v) {
+    uint8_t *o = f.packRaw(size<T>());
+    std::apply([&](auto... m) {
+        ((memcpy(o, &(v.*m), sizeof(v.*m)), o += sizeof(v.*m)), ...);
+    }, T::schemaFields());
+    return f;
+}
+
+/** unpack struct from Frame, return false if the Frame is too short */
+template<typename T>
+bool unpack(Frame &f, T &v) {
+    const uint8_t *p = f.unpackRaw(size<T>());
+    if (!p) return false;
+    std::apply([&](auto... m) {
+        ((memcpy(&(v.*m), p, sizeof(v.*m)), p += sizeof(v.*m)), ...);
+    }, T::schemaFields());
+    return true;
+}
+
+/** create descriptor Frame for struct T sent with Frame id `of`
+ *
+ * payload: `[of: u8] name \0 format \0 fieldnames \0`, where format is
+ * a python `struct` format string, and fieldnames are comma separated
+ */
+template<typename T>
+Frame describe(uint8_t id, uint8_t of) {
+    Frame f{id};
+    f.b = Buffer<uint8_t>(255);
+    f.pack<uint8_t>(of);
+    auto str = [&](const char *s) {
+        for (; *s; ++s) if (*s != ' ') f.b.append(*s);
+        f.b.append(0);
+    };
+    str(T::schemaName());
+    f.b.append('<');
+    std::apply([&](auto... m) {
+        auto one = [&](auto m) {
+            using F = std::remove_reference_t<decltype(std::declval<T>().*m)>;
+            if constexpr (std::is_array_v<F>) {
+                using E = std::remove_all_extents_t<F>;
+                char n[8];
+                int len = snprintf(n, sizeof(n), "%zu", sizeof(F) / sizeof(E));
+                for (int i = 0; i < len; ++i) f.b.append(n[i]);
+                f.b.append(code<E>());
+            } else {
+                f.b.append(code<F>());
+            }
+        };
+        (one(m), ...);
+    }, T::schemaFields());
+    f.b.append(0);
+    str(T::schemaNames());
+    return f;
+}
+}
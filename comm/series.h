@@ -31,3 +31,138 @@ struct SeriesUnpacker {
         return nullptr;
     }
 };
+
+/** streaming unpacker for data series, writing into a given destination
+ *
+ * every chunk carries its position in the series:
+ * ```
+ *      [offset: u32][total: u32] offset..offset+LEN-1: T
+ * ```
+ * all chunks but the last carry LEN elements. Chunks may arrive in any
+ * order, duplicates are ignored. The first `available()` elements of the
+ * series are complete and can be used before the whole series arrived.
+ *
+ * The destination is used as ring if it is shorter than the series:
+ * element `i` is stored at `i % dst.size`, and consumers `release` elements
+ * they are done with to make room for the following ones. Chunks not
+ * fitting into the ring yet are dropped, and have to be requested again
+ * ```
+ *      Buffer<double> traj = 1000;
+ *      SeriesStream<double> s{traj};
+ *      reg.subscribe(12, s, &SeriesStream<double>::handleFrame);
+ *      ...
+ *      if (s.gaps() && stalled) s.requestMissing(min.out, 13);
+ * ```
+ */
+template<typename T, int FRAMELEN=80>
+struct SeriesStream {
+    /** number of elements per chunk */
+    static constexpr size_t LEN = FRAMELEN / sizeof(T);
+    /** stream into given destination
+     *
+     * ring destinations must hold a multiple of LEN elements
+     */
+    SeriesStream(Buffer<T> &dst)
+            : dst(dst), chunks((dst.size + LEN - 1) / LEN), seen((chunks + 31) / 32) {
+        seen.len = seen.size;
+        reset();
+    }
+    /** forget about current series */
+    void reset() {
+        total_ = avail = released = received_ = high = 0;
+        for (auto &w : seen) w = 0;
+    }
+    /** number of elements of the current series */
+    size_t total() const { return total_; }
+    /** number of elements received */
+    size_t received() const { return received_; }
+    /** number of elements without gaps from the start of the series */
+    size_t available() const { return avail; }
+    /** true if whole series received */
+    bool done() const { return total_ && avail == total_; }
+    /** true if chunks after a missing one were received */
+    bool gaps() const { return high > avail; }
+    /** access element of series, must be available and not released */
+    T &operator[](size_t ix) {
+        assert(ix >= released && ix < avail);
+        return dst.buf[ix % dst.size];
+    }
+    /** mark the first `n` elements as consumed, making room in a ring */
+    void release(size_t n) {
+        assert(n <= avail);
+        for (size_t c = released / LEN; c < n / LEN; ++c) clear(c);
+        released = n - n % LEN;
+    }
+    /** handle single chunk, return number of new elements */
+    size_t unpack(Frame &f) {
+        if (f.b.len < 8) return 0;
+        uint32_t offset = f.unpack<uint32_t>();
+        uint32_t total = f.unpack<uint32_t>();
+        if (total != total_ || (done() && offset == 0)) {
+            reset();
+            total_ = total;
+            if (dst.size < total) assert(dst.size % LEN == 0);
+        }
+        if (offset % LEN || offset >= total) return 0;
+        size_t n = total - offset < LEN ? total - offset : LEN;
+        if (f.b.len < 8 + n * sizeof(T)) return 0;
+        if (offset < released || offset + n > released + dst.size) return 0;
+        size_t chunk = offset / LEN;
+        if (isset(chunk)) return 0;
+        const uint8_t *src = f.b.buf + 8;
+        size_t at = offset % dst.size;
+        size_t first = dst.size - at < n ? dst.size - at : n;
+        memcpy(dst.buf + at, src, first * sizeof(T));
+        memcpy(dst.buf, src + first * sizeof(T), (n - first) * sizeof(T));
+        set(chunk);
+        received_ += n;
+        if (offset + n > high) high = offset + n;
+        while (avail < total_ && avail < released + dst.size
+                && isset(avail / LEN)) {
+            avail += total_ - avail < LEN ? total_ - avail : LEN;
+        }
+        return n;
+    }
+    /** FrameRegistry compatible handler */
+    void handleFrame(Frame &f) {
+        unpack(f);
+    }
+    /** ask the sender to retransmit missing chunks
+     *
+     * pushes Frames with id `id` of `[offset: u32][count: u32]` element
+     * ranges, covering the gaps up to the last received chunk
+     */
+    void requestMissing(Sink<Frame> &out, uint8_t id) {
+        Frame f{id};
+        for (size_t c = avail / LEN; c * LEN < high;) {
+            if (isset(c)) { ++c; continue; }
+            size_t start = c;
+            while (c * LEN < high && !isset(c)) ++c;
+            if (f.b.len + 8 >= f.b.size) {
+                out.trypush(std::move(f));
+                f = Frame{id};
+            }
+            f.pack<uint32_t>(start * LEN).pack<uint32_t>((c - start) * LEN);
+        }
+        if (f.b.len) out.trypush(std::move(f));
+    }
+private:
+    Buffer<T> &dst;
+    const size_t chunks;
+    /** received chunks, indexed modulo chunks in destination */
+    Buffer<uint32_t> seen;
+    size_t total_, avail, released, received_, high;
+    size_t slot(size_t chunk) const { return chunk % chunks; }
+    bool isset(size_t chunk) const {
+        size_t s = slot(chunk);
+        return seen.buf[s / 32] & 1U << s % 32;
+    }
+    void set(size_t chunk) {
+        size_t s = slot(chunk);
+        seen.buf[s / 32] |= 1U << s % 32;
+    }
+    void clear(size_t chunk) {
+        size_t s = slot(chunk);
+        seen.buf[s / 32] &= ~(1U << s % 32);
+    }
+};
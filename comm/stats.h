@@ -0,0 +1,41 @@
+/** @file stats.h
+ *
+ * Copyright (c) 2026 IACE
+ *
+ * reporting of the instrumentation counters collected with utils/stats.h
+ * as Frames, see core/stats.h for reports through a Logger
+ */
+#pragma once
+#include <utils/queue.h>
+
+#include "frameregistry.h"
+
+#ifdef TOOL_LIBS_STATS
+namespace Stats {
+/** push heap and queue statistics as Frames with given id
+ *
+ * the first Frame contains the global heap counters as
+ * `[0, allocs, frees, live, peak]`, every Queue follows in its own Frame
+ * as `[1, index, size, hwm, dropped]`, all as uint8 tag and uint32 values
+ */
+inline void report(Sink<Frame> &out, uint8_t id) {
+    Frame f{id};
+    f.pack<uint8_t>(0)
+        .pack<uint32_t>(heap.allocs)
+        .pack<uint32_t>(heap.frees)
+        .pack<uint32_t>(heap.live)
+        .pack<uint32_t>(heap.peak);
+    out.trypush(std::move(f));
+    uint32_t i = 0;
+    for (auto q = Queue::list; q; q = q->next, ++i) {
+        Frame f{id};
+        f.pack<uint8_t>(1)
+            .pack<uint32_t>(i)
+            .pack<uint32_t>(q->size)
+            .pack<uint32_t>(q->hwm)
+            .pack<uint32_t>(q->dropped);
+        out.trypush(std::move(f));
+    }
+}
+}
+#endif
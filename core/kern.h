@@ -4,6 +4,7 @@
  */
 #pragma once
 #include "timed.h"
+#include "evented.h"
 #include "logger.h"
 #include <setjmp.h>
 #include <inttypes.h>
@@ -39,10 +40,39 @@ public:
         if (!ok) exit( 127 ); // too many items in scheduled queue. DYING.
         time_ += dt_ms;
     }
+    /** Signal with calls attached, see `onReady` */
+    struct Ready : Signal, Schedule::Evented::Registry { };
+    /** register calls to be made as soon as `src` has data available
+     *
+     * instead of polling a Source every tick, the calls happen right after
+     * the Source (e.g. from within its receive interrupt) raised its Signal
+     * ```
+     *      k.onReady(min.in).call(min, &Min::poll);
+     * ```
+     * at most 8 Sources can be registered, more trip the Buffer's assert
+     */
+    template<typename T>
+    Schedule::Evented::Registry& onReady(Source<T> &src) {
+        auto r = new Ready;
+        readies.append(r);
+        src.notify(*r);
+        return *r;
+    }
+    /** make calls attached to all raised Signals */
+    void dispatchReady() {
+        for (auto r: readies) {
+            if (!r->pending) continue;
+            r->pending = false;
+            for (auto c: r->list) {
+                if (c->schedule(time)) c->call();
+            }
+        }
+    }
     /** kernel entry point */
     int run () {
         setjmp(jbf);
         while(go) {
+            dispatchReady();
             Scheduler::run();
             idle();
         }
@@ -55,7 +85,8 @@ public:
     }
     /** implement to not burn unnecessary cpu cycles
      *
-     * a simple sleep or 'wait for interrupt' will do
+     * a simple sleep or 'wait for interrupt' will do. Return early when
+     * data becomes available, to handle Signals raised in the meantime
      *
      * if running in a single thread, you probably want to
      * call `tick()` in this method to advance the time
@@ -67,7 +98,12 @@ public:
      * takes step size in microseconds. default is 1000
      */
     void setTimeStep(uint16_t dt_us);
+    ~Kernel() {
+        // platform wait lists drop them through Signal::forget
+        for (auto r: readies) delete r;
+    }
 private:
+    Buffer<Ready *> readies = 8;
     uint32_t time_{};
     bool go{true};
     int exit_code{};
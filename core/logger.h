@@ -65,9 +65,28 @@ public:
     }
     /** push otherwisely prepared Buffer through Logger */
     void push(Buffer<uint8_t> &&b) override {
+        out.push(prefixed(b));
+    }
+    /** push multiple otherwisely prepared Buffers through Logger
+     *
+     * Buffers not taken downstream are left as they are
+     */
+    size_t pushBatch(Buffer<uint8_t> *b, size_t n) override {
+        Buffer<uint8_t> tmp[8];
+        size_t i = 0;
+        while (i < n && !out.full()) {
+            size_t m = n - i < 8 ? n - i : 8;
+            for (size_t j = 0; j < m; ++j) tmp[j] = prefixed(b[i+j]);
+            size_t taken = out.pushBatch(tmp, m);
+            i += taken;
+            if (taken < m) break;
+        }
+        return i;
+    }
+    Buffer<uint8_t> prefixed(const Buffer<uint8_t> &b) {
         Buffer<uint8_t> tmp = pre();
         for (auto &c : b) { tmp.append(c); }
-        out.push(std::move(tmp));
+        return tmp;
     }
     /** create Logger wrapping a Buffer Sink */
     Logger(Sink<Buffer<uint8_t>> &snk) : out{snk} { }
@@ -0,0 +1,132 @@
+/** @file pipe.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#include "streams.h"
+
+/** statically composed stream pipelines
+ *
+ * a pipeline is built from a number of stages, chained together at compile
+ * time, so the compiler is free to inline the whole chain.
+ * A stage is any object callable as
+ * ```
+ *      // call `next(out)` for every object produced from `in`
+ *      template<typename Next>
+ *      void operator()(In &&in, Next &&next);
+ * ```
+ * see e.g. LineFilter::Stage, Hexify::Stage, Min::In::Stage, Min::Out::Stage.
+ *
+ * The last element of a pipeline is either a callable taking the objects
+ * produced by the last stage, or any Sink. At the front, a pipeline is
+ * either fed from a Source, or is itself used as a Sink. The virtual
+ * interfaces are thus only used at the edges of the pipeline:
+ * ```
+ *      auto lines = pipe(tty, LineFilter::Stage{}, [](Slice<uint8_t> &&l) {
+ *          // `l` is only valid during this call, see LineFilter::Stage
+ *          ...
+ *      });
+ *      k.every(1, lines, &decltype(lines)::poll);
+ *
+ *      auto hex = pipe<Frame>(Min::Out::Stage{}, Hexify::Stage{}, tty);
+ *      Sink<Frame> &out = hex;
+ * ```
+ */
+namespace Pipe {
+template<typename U> std::true_type sinkTest(Sink<U> *);
+std::false_type sinkTest(...);
+/** true if X implements any Sink */
+template<typename X>
+constexpr bool isSink = decltype(sinkTest((X *)nullptr))::value;
+
+/** end of pipe: existing Sink */
+template<typename X>
+struct Edge {
+    X &to;
+    template<typename V>
+    void operator()(V &&v) { to.trypush(std::move(v)); }
+    bool full() { return to.full(); }
+};
+/** end of pipe: callable */
+template<typename F>
+struct Call {
+    F f;
+    template<typename V>
+    void operator()(V &&v) { f(std::move(v)); }
+    bool full() { return false; }
+};
+/** a stage, chained to the rest of the pipe */
+template<typename Stage, typename Next>
+struct Link {
+    Stage stage;
+    Next next;
+    template<typename V>
+    void operator()(V &&v) { stage(std::move(v), next); }
+    bool full() { return next.full(); }
+};
+
+/** chain stages together, ending in the last element */
+template<typename E>
+auto chain(E &&end) {
+    using D = std::decay_t<E>;
+    if constexpr (isSink<D>) {
+        return Edge<D>{end};
+    } else {
+        return Call<D>{std::forward<E>(end)};
+    }
+}
+template<typename S, typename... R>
+auto chain(S &&stage, R&&... rest) {
+    using Next = decltype(chain(std::forward<R>(rest)...));
+    return Link<std::decay_t<S>, Next>{
+        std::forward<S>(stage), chain(std::forward<R>(rest)...)};
+}
+
+/** pipe fed from a Source */
+template<typename T, typename Chain>
+struct Pump {
+    Source<T> &from;
+    Chain chain;
+    /** pass everything available in the Source through the pipe
+     *
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void poll(uint32_t=0, uint32_t=0) {
+        while (!chain.full() && !from.empty()) {
+            chain(from.pop());
+        }
+    }
+};
+
+/** pipe usable as Sink */
+template<typename T, typename Chain>
+struct Entry : Sink<T> {
+    Chain chain;
+    Entry(Chain &&c) : chain(std::move(c)) { }
+    bool full() override { return chain.full(); }
+    using Sink<T>::push;
+    void push(T &&t) override { chain(std::move(t)); }
+    size_t pushBatch(T *items, size_t n) override {
+        size_t i = 0;
+        while (i < n && !chain.full()) chain(std::move(items[i++]));
+        return i;
+    }
+};
+}
+
+/** create pipe pulling from Source `from` through the given stages */
+template<typename T, typename... S>
+auto pipe(Source<T> &from, S&&... stages) {
+    using Chain = decltype(Pipe::chain(std::forward<S>(stages)...));
+    return Pipe::Pump<T, Chain>{from, Pipe::chain(std::forward<S>(stages)...)};
+}
+/** create Sink of T pushing through the given stages */
+template<typename T, typename... S>
+auto pipe(S&&... stages) {
+    using Chain = decltype(Pipe::chain(std::forward<S>(stages)...));
+    return Pipe::Entry<T, Chain>{Pipe::chain(std::forward<S>(stages)...)};
+}
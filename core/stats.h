@@ -0,0 +1,33 @@
+/** @file stats.h
+ *
+ * Copyright (c) 2026 IACE
+ *
+ * reporting of the instrumentation counters collected with utils/stats.h
+ * through a Logger, see comm/stats.h for reports as Frames
+ */
+#pragma once
+#include <utils/queue.h>
+
+#include "logger.h"
+
+#ifdef TOOL_LIBS_STATS
+namespace Stats {
+/** print heap and queue statistics through given Logger */
+inline void report(Logger &log) {
+    log.print("heap: allocs %zu frees %zu live %zuB peak %zuB\n",
+            heap.allocs, heap.frees, heap.live, heap.peak);
+    for (auto t = Type::list; t; t = t->next) {
+        size_t len;
+        const char *name = t->pretty(len);
+        log.print("  Buffer<%.*s>: allocs %zu frees %zu live %zuB peak %zuB\n",
+                (int)len, name, t->heap.allocs, t->heap.frees,
+                t->heap.live, t->heap.peak);
+    }
+    size_t i = 0;
+    for (auto q = Queue::list; q; q = q->next, ++i) {
+        log.print("queue %zu (%s): size %zu hwm %zu dropped %zu\n",
+                i, q->name ? q->name : "-", q->size, q->hwm, q->dropped);
+    }
+}
+}
+#endif
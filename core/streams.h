@@ -4,6 +4,7 @@
  * \todo should we provide empty or assert(false) implementations?
  */
 #pragma once
+#include <cstddef>
 #include <utility>
 
 /** generic object sink, i.e. consumer of objects
@@ -13,6 +14,7 @@
  */
 template<typename T>
 struct Sink {
+    virtual ~Sink() { }
     /// check if sink is full
     virtual bool full()=0;
     /// copy semantics
@@ -26,9 +28,44 @@ struct Sink {
     /// use this if you don't care if it's going to be successful.
     /// data gets discarded if sink is full.
     void trypush(T&& t) {
-        if (full()) return;
+        if (full()) {
+#ifdef TOOL_LIBS_STATS
+            dropped();
+#endif
+            return;
+        }
         push(std::move(t));
     }
+    /// move up to `n` objects out of `items`, stopping once the sink is full.
+    /// returns the number of objects taken.
+    ///
+    /// override this if a whole batch can be handled cheaper than
+    /// its items one by one
+    virtual size_t pushBatch(T *items, size_t n) {
+        size_t i = 0;
+        while (i < n && !full()) push(std::move(items[i++]));
+        return i;
+    }
+#ifdef TOOL_LIBS_STATS
+    /// called whenever `trypush` discards data. instrumentation only
+    virtual void dropped() { }
+#endif
+};
+
+/** readiness flag, raised by a Source once it has data available
+ *
+ * raising is safe from within interrupts, see Kernel::onReady
+ */
+struct Signal {
+    volatile bool pending{};
+    /// mark as pending
+    void raise() { pending = true; }
+    /// set by whoever keeps a reference to the Signal, e.g. a platform's
+    /// wait list. called on destruction, so the reference can be dropped
+    void (*forget)(Signal &){};
+    ~Signal() {
+        if (forget) forget(*this);
+    }
 };
 
 /** generic object source, i.e. generator of objects
@@ -38,9 +75,28 @@ struct Sink {
  */
 template<typename T>
 struct Source {
+    virtual ~Source() { }
     /// check if source is empty
     virtual bool empty()=0;
     /// pull object from source
     /// does _not_ check for data. guard by using 'if (!empty) { ... }'
     virtual T pop()=0;
+    /// move up to `max` objects into `out`, stopping once the source is empty.
+    /// returns the number of objects given.
+    ///
+    /// override this if a whole batch can be handed out cheaper than
+    /// its items one by one
+    virtual size_t popBatch(T *out, size_t max) {
+        size_t i = 0;
+        while (i < max && !empty()) out[i++] = pop();
+        return i;
+    }
+    /// raise `s` whenever data becomes available
+    ///
+    /// Sources wrapping other Sources should forward this upstream
+    virtual void notify(Signal &s) { readiness = &s; }
+    /// let registered Signal know that data became available
+    void ready() { if (readiness) readiness->raise(); }
+protected:
+    Signal *readiness{};
 };
@@ -0,0 +1,150 @@
+/** @file telemetry.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include <comm/frameregistry.h>
+#include <comm/schema.h>
+
+#include "kern.h"
+
+/** host configurable telemetry channels
+ *
+ * the firmware declares named channels, each pointing to a value that may
+ * be sampled at most every `period` ms. The host lists the channels and
+ * selects a subset with a decimation each through control Frames. Every
+ * ms, all due channels are packed into as few data Frames as possible.
+ * ```
+ *      Telemetry tm{min.out, 20};
+ *      tm.channel("x", x, 1);
+ *      tm.channel("current", motor.i, 5);
+ *      tm.registerWith(min.reg, 21);
+ * ```
+ * control Frames (host -> firmware), replies on the same id:
+ * ```
+ *      [LIST]                      -> one Frame per channel:
+ *                                     [LIST, index: u8, format: char,
+ *                                      period: u16, name...]
+ *                                     names are cut to fit a Frame
+ *      [SELECT, n: u8, n x (index: u8, decimation: u16)]
+ *                                     sample channel `index` every
+ *                                     `period * decimation` ms, all other
+ *                                     channels are switched off
+ * ```
+ * data Frames: `[time: u32] (index: u8, value)*`, where the size of each
+ * value follows from the format of the channel, a python `struct` format
+ * character.
+ * \note implicitly depends on a Kernel object `k` in this namespace to be alive
+ */
+class Telemetry {
+public:
+    /** control commands */
+    enum Command : uint8_t {
+        LIST,
+        SELECT,
+    };
+    /** create telemetry service sending data Frames with given id */
+    Telemetry(Sink<Frame> &out, uint8_t id, size_t channels=32)
+            : out(out), id(id), list(channels) {
+        k.every(1, *this, &Telemetry::tick);
+    }
+    /** declare channel sampling `value` at most every `period` ms
+     *
+     * return index of the channel
+     */
+    template<typename T>
+    uint8_t channel(const char *name, const T &value, uint16_t period=1) {
+        assert(list.len < list.size && list.len < 255 && period);
+        list.append(Channel{name, &value, sizeof(T), Schema::code<T>(), period});
+        return list.len - 1;
+    }
+    /** set Frame registry on which control Frames are received */
+    void registerWith(FrameRegistry &reg, uint8_t control) {
+        this->control = control;
+        reg.subscribe(control, *this, &Telemetry::handleFrame);
+    }
+    /** select channel with given decimation, 0 switches it off */
+    void select(uint8_t index, uint16_t decimation) {
+        if (index >= list.len) return;
+        auto &c = list[index];
+        c.every = c.period * decimation;
+        c.count = 0;
+    }
+    /** sample due channels and push them out
+     *
+     * signature fits for recurring calls, see Schedule::Recurring
+     */
+    void tick(uint32_t time, uint32_t dt) {
+        Frame f;
+        bool open = false;
+        for (size_t i = 0; i < list.len; ++i) {
+            auto &c = list[i];
+            if (!c.every) continue;
+            c.count += dt;
+            if (c.count < c.every) continue;
+            c.count = 0;
+            if (open && f.b.len + 1 + c.size > FRAMELEN) {
+                out.trypush(std::move(f));
+                open = false;
+            }
+            if (!open) {
+                f = Frame{id};
+                f.b = Buffer<uint8_t>(FRAMELEN);
+                f.pack<uint32_t>(time);
+                open = true;
+            }
+            *f.packRaw(1) = i;
+            memcpy(f.packRaw(c.size), c.value, c.size);
+        }
+        if (open) out.trypush(std::move(f));
+    }
+private:
+    /** maximum payload of a Min Frame */
+    static constexpr size_t FRAMELEN = 255;
+    struct Channel {
+        const char *name;
+        const void *value;
+        uint8_t size;
+        char format;
+        /** minimum sampling period in ms */
+        uint16_t period;
+        /** selected sampling period in ms, 0 if off */
+        uint32_t every{};
+        uint32_t count{};
+    };
+    Sink<Frame> &out;
+    const uint8_t id;
+    uint8_t control{};
+    Buffer<Channel> list;
+
+    void handleFrame(Frame &f) {
+        switch (f.unpack<uint8_t>()) {
+        case LIST:
+            for (size_t i = 0; i < list.len; ++i) {
+                auto &c = list[i];
+                Frame r{control};
+                r.b = Buffer<uint8_t>(FRAMELEN);
+                r.pack<uint8_t>(LIST)
+                    .pack<uint8_t>(i)
+                    .pack<char>(c.format)
+                    .pack<uint16_t>(c.period);
+                for (auto n = c.name; *n && r.b.len < r.b.size - 1; ++n) {
+                    r.pack<char>(*n);
+                }
+                out.trypush(std::move(r));
+            }
+            break;
+        case SELECT: {
+            uint8_t n = f.b.len >= 2 ? f.unpack<uint8_t>() : 0;
+            // truncated request, keep the current selection
+            if (f.b.len < 2 || n > (f.b.len - 2) / 3) break;
+            for (auto &c : list) c.every = 0;
+            for (uint8_t i = 0; i < n; ++i) {
+                uint8_t index = f.unpack<uint8_t>();
+                select(index, f.unpack<uint16_t>());
+            }
+            break;
+        }
+        }
+    }
+};
@@ -1,4 +1,5 @@
 #include <core/kern.h>
+#include "sys/ready.h"
 
 #include <chrono>
 #include <cstdio>
@@ -16,6 +17,8 @@ auto dt{microseconds{1000}};
 time_point next{steady_clock::now() + dt};
 
 void Kernel::idle() {
+    // data arrived before the next tick is due, go handle it
+    if (::Ready::wait(next)) return;
     std::this_thread::sleep_until(next);
     auto now = steady_clock::now();
     next += dt;
@@ -1,9 +1,14 @@
 #pragma once
 #include <utils/queue.h>
 #include <comm/can.h>
+#include "ready.h"
 #include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
 #include <cstring>
 #include <cstdlib>
 #include <cerrno>
@@ -12,11 +17,26 @@
 #include <unistd.h>
 
 namespace CAN {
+    /** SocketCAN backend
+     *
+     * frames are received and sent in batches of up to BATCH frames per
+     * syscall (recvmmsg / sendmmsg). With `TOOL_LIBS_CAN_FD`, CAN FD frames
+     * are enabled on the socket, and sent for Messages with `opts.fdf`,
+     * which needs an FD capable interface. Received Messages carry the kernel
+     * receive time stamp (SO_TIMESTAMPING), from the hardware if the
+     * interface supports it, else from the kernel software clock.
+     */
     struct HW : public CAN {
+        /** maximum number of frames per syscall */
+        static constexpr size_t BATCH = 32;
         int sock{};
         Queue<Message> rx;
-        Queue<struct can_frame> tx;
+        Queue<Message> tx;
         HW( const char *ifname ) {
+            for (size_t i = 0; i < BATCH; ++i) {
+                riov[i] = {&rframe[i], sizeof(rframe[i])};
+                tiov[i] = {&tframe[i], sizeof(tframe[i])};
+            }
             /* open CAN_RAW socket */
             sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
             /* set NONBLOCK */
@@ -46,33 +66,54 @@ namespace CAN {
                 perror("cannot bind socket to CAN interface");
                 return;
             }
+#if defined(TOOL_LIBS_CAN_FD)
+            int fd = 1;
+            if (setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FD_FRAMES,
+                        &fd, sizeof(fd)) == -1) {
+                perror("cannot enable CAN FD frames");
+            }
+#endif
+            int stamping = SOF_TIMESTAMPING_RX_SOFTWARE
+                | SOF_TIMESTAMPING_SOFTWARE
+                | SOF_TIMESTAMPING_RX_HARDWARE
+                | SOF_TIMESTAMPING_RAW_HARDWARE;
+            if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING,
+                        &stamping, sizeof(stamping)) == -1) {
+                perror("cannot enable CAN receive time stamps");
+            }
         }
         ~HW() {
+            Ready::remove(sock);
             close(sock);
         }
         bool full() override {
             return tx.full();
         }
         void push(Message &&msg) override {
-            struct can_frame frame = frameFromMessage(std::move(msg));
-            tx.push(frame);
+            tx.push(std::move(msg));
             process();
         }
         void process() {
             // transmit side
             while (!tx.empty()) {
-                auto frame = tx.front();
-                int l = write(sock, &frame, sizeof(frame));
+                size_t n = tx.size() < BATCH ? tx.size() : BATCH;
+                struct mmsghdr msgs[BATCH] {};
+                for (size_t i = 0; i < n; ++i) {
+                    auto msg = tx.getAt(i);
+                    tiov[i].iov_len = FD && msg.opts.fdf ? CANFD_MTU : CAN_MTU;
+                    tframe[i] = frameFromMessage(std::move(msg));
+                    msgs[i].msg_hdr.msg_iov = &tiov[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                }
+                int l = sendmmsg(sock, msgs, n, 0);
                 if (l < 0) {
                     if (errno != EAGAIN) {
                         perror("writing on CAN socket error");
                     }
                     break;
-                } else if ((size_t)l < sizeof(frame)) {
-                    fprintf(stderr, "write: incomplete CAN frame: %d\n", l);
-                } else { // success
-                    tx.pop();
                 }
+                for (int i = 0; i < l; ++i) tx.drop();
+                if ((size_t)l < n) break;
             }
             // receive side
             empty();
@@ -81,44 +122,105 @@ namespace CAN {
         Message pop() override {
             return rx.pop();
         }
+        /** raise `s` as soon as there is a frame to read */
+        void notify(Signal &s) override {
+            Source::notify(s);
+            Ready::add(sock, s);
+        }
+        /** read all pending frames that fit into the receive queue */
         bool empty() override {
-            struct can_frame frame;
-            int l = read(sock, &frame, sizeof(frame));
-            if (l < 0) {
-                if (errno != EAGAIN) {
-                    perror("reading on CAN socket error");
+            while (!rx.full()) {
+                size_t room = rx.capacity() - rx.size();
+                size_t n = room < BATCH ? room : BATCH;
+                struct mmsghdr msgs[BATCH] {};
+                for (size_t i = 0; i < n; ++i) {
+                    auto &h = msgs[i].msg_hdr;
+                    h.msg_iov = &riov[i];
+                    h.msg_iovlen = 1;
+                    h.msg_control = control[i];
+                    h.msg_controllen = sizeof(control[i]);
+                }
+                int l = recvmmsg(sock, msgs, n, MSG_DONTWAIT, nullptr);
+                if (l < 0) {
+                    if (errno != EAGAIN) {
+                        perror("reading on CAN socket error");
+                    }
+                    break;
                 }
-                return rx.empty();
-            } else if ((size_t)l < sizeof(frame)) { /* paranoid check ... */
-                fprintf(stderr, "read: incomplete CAN frame: %d\n", l);
-                return rx.empty();
+                for (int i = 0; i < l; ++i) {
+                    if (msgs[i].msg_len != CAN_MTU
+                            && msgs[i].msg_len != CANFD_MTU) {
+                        /* paranoid check ... */
+                        fprintf(stderr, "read: incomplete CAN frame: %d\n",
+                                msgs[i].msg_len);
+                        continue;
+                    }
+                    Message msg = messageFromFrame(rframe[i],
+                            msgs[i].msg_len == CANFD_MTU);
+                    msg.stamp = stampOf(msgs[i].msg_hdr);
+                    rx.push(std::move(msg));
+                }
+                if ((size_t)l < n) break;
+            }
+            return rx.empty();
+        }
+        /** install filters as CAN_RAW_FILTER on the socket, so the kernel
+         * drops all other frames */
+        void filter(const Filter *f, size_t n) override {
+            struct can_filter all {0, 0};
+            Buffer<struct can_filter> raw = n ? n : 1;
+            for (size_t i = 0; i < n; ++i) {
+                raw.append({
+                    .can_id = f[i].ide ? f[i].id | CAN_EFF_FLAG : f[i].id,
+                    .can_mask = f[i].mask | CAN_EFF_FLAG,
+                });
+            }
+            if (!n) raw.append(all);
+            if (setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FILTER, raw.buf,
+                        raw.len * sizeof(struct can_filter)) == -1) {
+                perror("cannot set CAN filters");
             }
-            Message msg = messageFromFrame(frame);
-            rx.push(msg);
-            return false;
         }
-        struct can_frame frameFromMessage(Message &&msg) {
-            struct can_frame f {};
+        /** receive time stamp from control messages, hardware preferred */
+        static uint64_t stampOf(struct msghdr &h) {
+            for (auto c = CMSG_FIRSTHDR(&h); c; c = CMSG_NXTHDR(&h, c)) {
+                if (c->cmsg_level != SOL_SOCKET
+                        || c->cmsg_type != SO_TIMESTAMPING) continue;
+                struct scm_timestamping ts;
+                memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                auto &t = ts.ts[2].tv_sec || ts.ts[2].tv_nsec ? ts.ts[2] : ts.ts[0];
+                return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+            }
+            return 0;
+        }
+        struct canfd_frame frameFromMessage(Message &&msg) {
+            struct canfd_frame f {};
             f.can_id = msg.id;
             if (msg.opts.rtr) f.can_id |= CAN_RTR_FLAG;
-            f.len = msg.opts.dlc;
-            for (int i = 0; i < f.len; ++i) {
-                f.data[i] = ((uint8_t*)&msg.data)[i];
-            }
+            if (msg.opts.ide) f.can_id |= CAN_EFF_FLAG;
+            f.len = msg.len();
+            if (FD && msg.opts.fdf) f.flags = CANFD_FDF | (msg.opts.brs ? CANFD_BRS : 0);
+            memcpy(f.data, msg.bytes, f.len);
             return f;
         }
-        Message messageFromFrame(struct can_frame frame) {
+        Message messageFromFrame(const struct canfd_frame &frame, bool fd=false) {
             Message msg {
-                .id = frame.can_id & ((1<<30)-1),
+                .id = frame.can_id & CAN_EFF_MASK,
                 .opts = {
                     .rtr = !!(frame.can_id & CAN_RTR_FLAG),
-                    .dlc = frame.len,
+                    .ide = !!(frame.can_id & CAN_EFF_FLAG),
+                    .dlc = dlcOf(frame.len),
+                    .fdf = fd,
+                    .brs = fd && frame.flags & CANFD_BRS,
                 },
             };
-            for (int i = 0; i < frame.len; ++i) {
-                ((uint8_t*)&msg.data)[i] = frame.data[i];
-            }
+            memcpy(msg.bytes, frame.data, msg.len());
             return msg;
         }
+    private:
+        struct canfd_frame rframe[BATCH], tframe[BATCH];
+        struct iovec riov[BATCH], tiov[BATCH];
+        /** room for the time stamp control message per frame */
+        char control[BATCH][CMSG_SPACE(sizeof(struct scm_timestamping))];
     };
 }
@@ -1,6 +1,7 @@
 #pragma once
 #include <utils/queue.h>
 #include <core/logger.h>
+#include "ready.h"
 
 #include <arpa/inet.h>
 #include <cerrno>
@@ -21,6 +22,7 @@ struct TTY:
         fd = open(path, O_RDWR | O_NONBLOCK);
     }
     ~TTY() {
+        Ready::remove(fd);
         close(fd);
     }
     bool full() override {
@@ -47,6 +49,21 @@ struct TTY:
     Buffer<uint8_t> pop() override {
         return rx.pop();
     }
+    /** raise `s` as soon as there is data to read */
+    void notify(Signal &s) override {
+        Source::notify(s);
+        Ready::add(fd, s);
+    }
+    size_t pushBatch(Buffer<uint8_t> *b, size_t n) override {
+        n = tx.pushBatch(b, n);
+        process();
+        return n;
+    }
+    size_t popBatch(Buffer<uint8_t> *out, size_t max) override {
+        size_t n = rx.popBatch(out, max);
+        while (n < max && !TTY::empty()) out[n++] = rx.pop();
+        return n;
+    }
     void process() {
         //transmit side
         while (!tx.empty()) {
@@ -104,6 +121,7 @@ struct UDP:
         }
     }
     ~UDP() {
+        Ready::remove(fd);
         close(fd);
     }
     bool full() override {
@@ -131,6 +149,21 @@ struct UDP:
     Buffer<uint8_t> pop() override {
         return rx.pop();
     }
+    /** raise `s` as soon as there is data to read */
+    void notify(Signal &s) override {
+        Source::notify(s);
+        Ready::add(fd, s);
+    }
+    size_t pushBatch(Buffer<uint8_t> *b, size_t n) override {
+        n = tx.pushBatch(b, n);
+        process();
+        return n;
+    }
+    size_t popBatch(Buffer<uint8_t> *out, size_t max) override {
+        size_t n = rx.popBatch(out, max);
+        while (n < max && !UDP::empty()) out[n++] = rx.pop();
+        return n;
+    }
     void process() {
         //transmit side
         while (!tx.empty()) {
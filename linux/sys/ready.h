@@ -0,0 +1,83 @@
+/** @file ready.h
+ *
+ * Copyright (c) 2026 IACE
+ */
+#pragma once
+#include <utils/buffer.h>
+#include <core/streams.h>
+
+#include <chrono>
+#include <poll.h>
+
+/** file descriptors the Kernel waits on while idle
+ *
+ * Sources backed by a file descriptor register here once they are asked to
+ * `notify`, so their Signal is raised as soon as data arrives instead of on
+ * the next tick.
+ */
+namespace Ready {
+/** file descriptor and Signal to raise once it is readable */
+struct Entry {
+    int fd;
+    Signal *signal;
+};
+/** maximum number of registered fds, `add`ing more trips an assert */
+static constexpr size_t MAX = 16;
+inline Buffer<Entry> fds = MAX;
+/** drop all entries matching `pred` */
+template<typename Pred>
+void drop(Pred pred) {
+    size_t j = 0;
+    for (size_t i = 0; i < fds.len; ++i) {
+        if (!pred(fds[i])) fds[j++] = fds[i];
+    }
+    fds.len = j;
+}
+/** stop waiting on `fd`, call before closing it */
+inline void remove(int fd) {
+    drop([fd](const Entry &e) { return e.fd == fd; });
+}
+/** stop raising `s`, called when it is destroyed */
+inline void forget(Signal &s) {
+    drop([&s](const Entry &e) { return e.signal == &s; });
+}
+/** raise `s` whenever `fd` becomes readable
+ *
+ * registering an fd again replaces its Signal and takes no extra slot.
+ * The entry is removed again by `remove` or once `s` is destroyed
+ */
+inline void add(int fd, Signal &s) {
+    s.forget = forget;
+    for (auto &e: fds) {
+        if (e.fd == fd) {
+            e.signal = &s;
+            return;
+        }
+    }
+    fds.append({fd, &s});
+}
+/** wait until any registered fd is readable, at most until `deadline`
+ *
+ * returns true if woken up by a readable fd, and raises its Signal
+ */
+template<typename Clock, typename Dur>
+bool wait(std::chrono::time_point<Clock, Dur> deadline) {
+    using namespace std::chrono;
+    if (fds.len == 0) return false;
+    auto left = duration_cast<nanoseconds>(deadline - Clock::now());
+    if (left.count() <= 0) return false;
+    struct pollfd pfd[MAX];
+    for (size_t i = 0; i < fds.len; ++i) {
+        pfd[i] = {.fd = fds[i].fd, .events = POLLIN, .revents = 0};
+    }
+    struct timespec ts = {
+        .tv_sec = (time_t)(left.count() / 1000000000),
+        .tv_nsec = (long)(left.count() % 1000000000),
+    };
+    if (ppoll(pfd, fds.len, &ts, nullptr) <= 0) return false;
+    for (size_t i = 0; i < fds.len; ++i) {
+        if (pfd[i].revents & POLLIN) fds[i].signal->raise();
+    }
+    return true;
+}
+}
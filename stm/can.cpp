@@ -3,6 +3,7 @@
 using namespace CAN;
 
 void _start(CAN_HandleTypeDef *handle, const Message &msg) {
+    assert(!msg.opts.fdf); // bxCAN only handles classic frames
     uint32_t mbox;
     CAN_TxHeaderTypeDef header = {
         .StdId = msg.opts.ide ? 0 : msg.id & 0x7ff,
@@ -0,0 +1,35 @@
+#include <comm/crc.h>
+#include "sys/hal.h"
+
+#if !defined(STM32F7)
+#error "CRC32 hardware engine needs the configurable CRC unit of STM32F7"
+#endif
+
+/* CRC unit setup for the reflected IEEE 802.3 CRC32:
+ * default polynomial 0x04c11db7, input bit reversal by byte, reversed output.
+ * The unit shifts in each word MSB first, so words are written big endian.
+ * The state is kept reflected, so the initial value is its bit reversal.
+ * Not reentrant: do not use from interrupt context and main loop alike.
+ */
+namespace {
+/* the CMSIS peripheral macro hides namespace CRC, keep it as pointer */
+CRC_TypeDef *const unit = CRC;
+#undef CRC
+struct Unit {
+    void word(uint32_t w) { unit->DR = w; }
+    void byte(uint8_t b) { *(__IO uint8_t *)&unit->DR = b; }
+};
+}
+uint32_t CRC::Hardware::update(uint32_t crc, const uint8_t *p, size_t n) {
+    static bool clocked = false;
+    if (!clocked) {
+        __HAL_RCC_CRC_CLK_ENABLE();
+        clocked = true;
+    }
+    unit->CR = CRC_CR_REV_IN_0 | CRC_CR_REV_OUT;
+    unit->INIT = __RBIT(crc);
+    unit->CR |= CRC_CR_RESET;
+    Unit u;
+    CRC::feed(u, p, n);
+    return unit->DR;
+}
@@ -21,6 +21,8 @@ struct HW : public CAN {
     using Sink::push;
     Message pop() override { return rx.pop(); };
     bool empty() override { return rx.empty(); };
+    /** raise `s` from the receive interrupt */
+    void notify(Signal &s) override { rx.notify(s); }
 
     Queue<Message> rx;
 
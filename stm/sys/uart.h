@@ -50,10 +50,16 @@ struct HW : public Sink<Buffer<uint8_t>>, public Source<Buffer<uint8_t>> {
     /** push bytebuffer into sending queue */
     void push(Buffer<uint8_t> &&tx) override;
     using Sink<Buffer<uint8_t>>::push;
+    /** push multiple bytebuffers into sending queue */
+    size_t pushBatch(Buffer<uint8_t> *tx, size_t n) override;
     /** pull buffer from receiving queue */
     Buffer<uint8_t> pop() override;
+    /** pull multiple buffers from receiving queue */
+    size_t popBatch(Buffer<uint8_t> *rx, size_t max) override;
     /** check if receiving queue is empty */
     bool empty() override;
+    /** raise `s` from the receive interrupt */
+    void notify(Signal &s) override { rx.q.notify(s); }
     /** interrupt handler
      *
      * call this directly in interrupt
@@ -201,9 +201,17 @@ void HW::push(Buffer<uint8_t> &&b) {
     tx.q.push(std::move(b));
     poll(this);
 }
+size_t HW::pushBatch(Buffer<uint8_t> *b, size_t n) {
+    n = tx.q.pushBatch(b, n);
+    poll(this);
+    return n;
+}
 bool HW::empty() {
     return rx.q.empty();
 }
 Buffer<uint8_t> HW::pop() {
     return rx.q.pop();
 }
+size_t HW::popBatch(Buffer<uint8_t> *b, size_t max) {
+    return rx.q.popBatch(b, max);
+}
@@ -213,3 +213,34 @@ TEST_CASE("tool-libs: queue: buffer of buffers cstr") {
     CHECK(b[1] == 2);
     CHECK(b[2] == 3);
 }
+TEST_CASE("tool-libs: queue: batch") {
+    Queue<int> q{5};
+    int in[7] = {0, 1, 2, 3, 4, 5, 6};
+    int out[7]{};
+    q.push(-1);
+    CHECK(q.pop() == -1);
+    CHECK(q.pushBatch(in, 7) == 5);
+    CHECK(q.full());
+    CHECK(q.popBatch(out, 3) == 3);
+    CHECK(q.pushBatch(in+5, 2) == 2);
+    CHECK(q.popBatch(out+3, 7) == 4);
+    CHECK(q.empty());
+    for (int i = 0; i < 7; ++i) {
+        CHECK(out[i] == i);
+    }
+    SUBCASE("default fallback") {
+        struct Ints : Sink<int>, Source<int> {
+            Queue<int> q{3};
+            bool full() override { return q.full(); }
+            void push(int &&i) override { q.push(std::move(i)); }
+            bool empty() override { return q.empty(); }
+            int pop() override { return q.pop(); }
+        } s;
+        Sink<int> &snk = s;
+        Source<int> &src = s;
+        CHECK(snk.pushBatch(in, 7) == 3);
+        CHECK(src.popBatch(out, 7) == 3);
+        CHECK(out[2] == 2);
+        CHECK(src.popBatch(out, 7) == 0);
+    }
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <comm/min.h>
+#include <comm/compress.h>
+
+using namespace std::chrono;
+
+/** counts bytes, discards data */
+struct Count : Sink<Buffer<uint8_t>> {
+    size_t bytes{};
+    bool full() override { return false; }
+    void push(Buffer<uint8_t> &&b) override { bytes += b.len; }
+};
+
+template<typename F>
+double measure(F f) {
+    auto start = steady_clock::now();
+    f();
+    return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+constexpr uint32_t ROUNDS = 100000;
+
+/** telemetry as streamed by a typical experiment every ms:
+ * controller state as doubles, setpoint, timestamp and a few flags
+ */
+Frame state(uint32_t t) {
+    Frame f{10};
+    double x = t * 1e-3;
+    f.pack<uint32_t>(t)
+        .pack<double>(sin(x))
+        .pack<double>(cos(x) * 0.5)
+        .pack<double>(sin(x) * cos(3 * x))
+        .pack<double>(t < ROUNDS / 2 ? 1.0 : 2.0)
+        .pack<float>(0.01f * (t % 100))
+        .pack<uint8_t>(1)
+        .pack<uint8_t>(0);
+    return f;
+}
+/** encoder counts, quantized integers */
+Frame counts(uint32_t t) {
+    Frame f{11};
+    f.pack<uint32_t>(t)
+        .pack<int32_t>(t / 7)
+        .pack<int32_t>(-(int32_t)t / 13)
+        .pack<int16_t>(1000 * sin(t * 1e-3));
+    return f;
+}
+
+int main() {
+    Count plain, zipped;
+    Min::Out direct{plain}, viaZip{zipped};
+    Queue<Frame> loop{2};
+    Compress tx{loop, viaZip}, rx{loop, loop};
+    tx.enable(true);
+
+    double t_plain = measure([&]() {
+        for (uint32_t t = 0; t < ROUNDS; ++t) {
+            direct.push(state(t));
+            direct.push(counts(t));
+        }
+    });
+    double t_zip = measure([&]() {
+        for (uint32_t t = 0; t < ROUNDS; ++t) {
+            tx.out.push(state(t));
+            tx.out.push(counts(t));
+        }
+    });
+    printf("Min::Out:             %8.2fms %9zu bytes\n", t_plain, plain.bytes);
+    printf("Compress -> Min::Out: %8.2fms %9zu bytes (%.1f%%)\n",
+            t_zip, zipped.bytes, 100. * zipped.bytes / plain.bytes);
+
+    Compress enc{loop, loop};
+    enc.enable(true);
+    rx.enable(true);
+    size_t n{};
+    double t_dec = measure([&]() {
+        for (uint32_t t = 0; t < ROUNDS; ++t) {
+            enc.out.push(state(t));
+            while (!rx.in.empty()) {
+                rx.in.pop();
+                n++;
+            }
+        }
+    });
+    printf("Compress roundtrip:   %8.2fms %9zu frames, %zu dropped\n",
+            t_dec, n, rx.in.dropped);
+}
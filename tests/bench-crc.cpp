@@ -0,0 +1,37 @@
+#include <chrono>
+#include <cstdio>
+#include <comm/crc.h>
+
+using namespace std::chrono;
+
+template<typename F>
+double measure(F f) {
+    auto start = steady_clock::now();
+    f();
+    return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+constexpr size_t ROUNDS = 20000, LEN = 128;
+
+template<typename Engine>
+void run(const char *name, const uint8_t *data) {
+    volatile uint32_t sink{};
+    double t = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            BasicCRC32<Engine> c;
+            c.update(data, LEN);
+            sink = sink + c.finalize();
+        }
+    });
+    printf("%-8s %8.2fms %8.1f MB/s\n", name, t, ROUNDS * LEN / t / 1e3);
+}
+
+int main() {
+    uint8_t data[LEN];
+    for (size_t i = 0; i < LEN; ++i) data[i] = i * 37;
+    printf("CRC32 over %zu frames of %zuB\n", ROUNDS, LEN);
+    run<CRC::Bitwise>("bitwise", data);
+    run<CRC::Nibble>("nibble", data);
+    run<CRC::Slice8>("slice8", data);
+    return 0;
+}
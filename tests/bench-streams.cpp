@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstdio>
+#include <comm/min.h>
+#include <comm/bufferutils.h>
+#include <comm/line.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+/** counts bytes, discards data */
+struct Count : Sink<Buffer<uint8_t>> {
+    size_t bytes{};
+    bool full() override { return false; }
+    void push(Buffer<uint8_t> &&b) override { bytes += b.len; }
+};
+
+template<typename F>
+double measure(F f) {
+    auto start = steady_clock::now();
+    f();
+    return duration<double, std::milli>(steady_clock::now() - start).count();
+}
+
+constexpr size_t ROUNDS = 20000, N = 16;
+
+int main() {
+    Frame frames[N];
+    auto refill = [&]() {
+        for (size_t i = 0; i < N; ++i) {
+            frames[i] = Frame{(uint8_t)i};
+            frames[i].pack(3.14 * i).pack<uint32_t>(i);
+        }
+    };
+    Count a, b;
+    Hexify ha{a}, hb{b};
+    Min::Out per{ha}, batched{hb};
+    double t_per = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            refill();
+            for (auto &f : frames) per.push(std::move(f));
+        }
+    });
+    double t_batch = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            refill();
+            batched.pushBatch(frames, N);
+        }
+    });
+    printf("Frame -> Min::Out -> Hexify: per item %8.2fms, batched %8.2fms (%zu/%zu bytes)\n",
+            t_per, t_batch, a.bytes, b.bytes);
+
+    Queue<Buffer<uint8_t>> src{N};
+    LineFilter lines{src};
+    Buffer<uint8_t> out[N];
+    auto fill = [&]() {
+        while (!src.full()) {
+            src.push(Buffer<uint8_t>{(const uint8_t *)"hello world\n", 12});
+        }
+    };
+    size_t n_per{}, n_batch{};
+    t_per = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            fill();
+            Source<Buffer<uint8_t>> &s = lines;
+            while (!s.empty()) n_per += s.pop().len;
+        }
+    });
+    t_batch = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            fill();
+            Source<Buffer<uint8_t>> &s = lines;
+            size_t n;
+            while ((n = s.popBatch(out, N))) {
+                for (size_t i = 0; i < n; ++i) n_batch += out[i].len;
+            }
+        }
+    });
+    printf("Buffer -> LineFilter -> app: per item %8.2fms, batched %8.2fms (%zu/%zu bytes)\n",
+            t_per, t_batch, n_per, n_batch);
+
+    /** one write syscall per Buffer, as TTY / UDP do */
+    struct Write : Sink<Buffer<uint8_t>> {
+        int fd = open("/dev/null", O_WRONLY);
+        size_t writes{};
+        ~Write() { close(fd); }
+        bool full() override { return false; }
+        void push(Buffer<uint8_t> &&b) override {
+            writes += write(fd, b.buf, b.len) > 0;
+        }
+    } wa, wb, wc;
+    Min::Out direct{wa};
+    Coalesce co{wb, 512, 1};
+    Min::Out merged{co};
+    t_per = measure([&]() {
+        for (size_t r = 0; r < ROUNDS; ++r) {
+            refill();
+            for (auto &f : frames) direct.push(std::move(f));
+        }
+    });
+    t_batch = measure([&]() {
+        for (uint32_t r = 0; r < ROUNDS; ++r) {
+            refill();
+            for (auto &f : frames) merged.push(std::move(f));
+            co.poll(r, 1);
+        }
+    });
+    printf("Frame -> Min::Out -> write: direct %8.2fms, coalesced %8.2fms (%zu/%zu writes)\n",
+            t_per, t_batch, wa.writes, wb.writes);
+    Min::Out collect{wc, 2048};
+    t_batch = measure([&]() {
+        for (uint32_t r = 0; r < ROUNDS; ++r) {
+            refill();
+            for (auto &f : frames) collect.push(std::move(f));
+            collect.flush();
+        }
+    });
+    printf("Frame -> Min::Out(batch) -> write: %8.2fms (%zu writes)\n",
+            t_batch, wc.writes);
+
+    const char *names[] = {"STREAM", "DATAGRAM", "COBS"};
+    for (auto mode : {Min::STREAM, Min::DATAGRAM, Min::COBS}) {
+        Queue<Buffer<uint8_t>> wire{N};
+        Min::Out enc{wire};
+        enc.framing(mode);
+        for (size_t i = 0; i < N; ++i) {
+            Frame f{(uint8_t)i};
+            for (size_t j = 0; j < 12; ++j) f.pack(1.5 * i * j);
+            enc.push(std::move(f));
+        }
+        Buffer<uint8_t> stream = N * Min::Out::bound(96);
+        while (!wire.empty()) {
+            auto one = wire.pop();
+            memcpy(stream.buf + stream.len, one.buf, one.len);
+            stream.len += one.len;
+        }
+        size_t decoded{};
+        Min::In::Stage dec{mode};
+        double t_dec = measure([&]() {
+            for (size_t r = 0; r < ROUNDS; ++r) {
+                dec(Buffer<uint8_t>{stream}, [&](Frame &&) { decoded++; });
+            }
+        });
+        printf("Buffer -> Min::In::Stage(%s): %8.2fms, %.2f Mframes/s "
+                "(%zu frames, %zu bytes)\n", names[mode],
+                t_dec, decoded / t_dec / 1e3, decoded, stream.len);
+    }
+    return 0;
+}
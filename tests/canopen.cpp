@@ -0,0 +1,485 @@
+#include <doctest/doctest.h>
+#include <comm/canopen.h>
+// minimal Kernel idle implementation
+void Kernel::idle() {
+    tick(1);
+};
+Kernel k;
+
+using namespace CAN;
+struct Bus : CAN::CAN {
+    Queue<Message> rx{256}, tx{1024};
+    bool full() override { return tx.full(); }
+    using Sink<Message>::push;
+    void push(Message &&m) override { tx.push(std::move(m)); }
+    bool empty() override { return rx.empty(); }
+    Message pop() override { return rx.pop(); }
+    Buffer<Filter> filters;
+    void filter(const Filter *f, size_t n) override {
+        filters = n;
+        for (size_t i = 0; i < n; ++i) filters.append(f[i]);
+    }
+};
+
+struct Drive : Open::Device {
+    Drive(Open::Dispatch &d, uint8_t id) : Device(d, id) { }
+    Open::TPDO tpdo[2] {
+        {.N = 1, .type = Open::SYNC, .map = {{.ix = 0x6064, .len = 32}}},
+        {.N = 2, .type = Open::SYNC, .map = {{.ix = 0x606c, .len = 32}}},
+    };
+    int32_t pos{}, vel{};
+    size_t got{};
+    void callback(Open::SDO) override { }
+    void callback(Open::TPDO rq) override {
+        got++;
+        (rq.N == 1 ? pos : vel) = rq.map[0].data;
+    }
+};
+
+TEST_CASE("tool-libs: canopen: pdo dispatch") {
+    Bus bus;
+    Open::Dispatch canopen{bus, Open::Dispatch::NONE, 254};
+    Drive *drives[127];
+    for (uint8_t id = 1; id < 128; ++id) {
+        auto d = drives[id - 1] = new Drive(canopen, id);
+        d->tpdo[0].COB = 0x180 + id;
+        // 29-bit COB-ID for some
+        d->tpdo[1].COB = id % 4 ? 0x280 + id : 0x1000000 + id;
+        canopen.registerPDO(&d->tpdo[0], d);
+        canopen.registerPDO(&d->tpdo[1], d);
+    }
+    // registering again is fine
+    canopen.registerPDO(&drives[0]->tpdo[0], drives[0]);
+    CHECK(canopen.pdo.entries.len == 254);
+
+    for (uint8_t id = 1; id < 128; ++id) {
+        auto &d = *drives[id - 1];
+        bus.rx.push({.data = id, .id = d.tpdo[0].COB, .opts = {.dlc = 4}});
+        bus.rx.push({.data = (uint64_t)-id, .id = d.tpdo[1].COB,
+                .opts = {.ide = id % 4 == 0, .dlc = 4}});
+        canopen.process();
+        CHECK(d.got == 2);
+        CHECK(d.pos == id);
+        CHECK(d.vel == -id);
+    }
+    // unknown ids are not PDOs
+    CHECK_FALSE(canopen.handlePDO({.id = 0x200, .opts = {.dlc = 4}}));
+    CHECK_FALSE(canopen.handlePDO({.id = 0x1000000, .opts = {.ide = 1, .dlc = 4}}));
+    // frame format has to match as well
+    CHECK_FALSE(canopen.handlePDO({.id = 0x181, .opts = {.ide = 1, .dlc = 4}}));
+    CHECK(drives[0]->got == 2);
+    // re-enabled with another COB-ID, the old one is stale
+    auto &d = *drives[4];
+    d.tpdo[0].COB = 0x7f0;
+    canopen.registerPDO(&d.tpdo[0], &d);
+    CHECK_FALSE(canopen.handlePDO({.id = 0x185, .opts = {.dlc = 4}}));
+    CHECK(canopen.handlePDO({.id = 0x7f0, .opts = {.dlc = 4}}));
+    // swapped COB-IDs
+    auto &s = *drives[7];
+    std::swap(s.tpdo[0].COB, s.tpdo[1].COB);
+    canopen.registerPDO(&s.tpdo[0], &s);
+    canopen.registerPDO(&s.tpdo[1], &s);
+    CHECK(canopen.handlePDO({.data = 11, .id = 0x1000008, .opts = {.ide = 1, .dlc = 4}}));
+    CHECK(canopen.handlePDO({.data = 12, .id = 0x188, .opts = {.dlc = 4}}));
+    CHECK(s.pos == 11);
+    CHECK(s.vel == 12);
+    // a COB-ID taken over from another PDO
+    d.tpdo[1].COB = 0x7f0;
+    canopen.registerPDO(&d.tpdo[1], &d);
+    CHECK(canopen.handlePDO({.data = 13, .id = 0x7f0, .opts = {.dlc = 4}}));
+    CHECK(d.vel == 13);
+    for (auto d : drives) delete d;
+}
+TEST_CASE("tool-libs: canopen: filters and heartbeats") {
+    Bus bus;
+    Open::Dispatch canopen{bus};
+    Drive a{canopen, 3};
+    a.tpdo[0].COB = 0x183;
+    a.tpdo[1].COB = 0x1000003;
+    canopen.registerPDO(&a.tpdo[0], &a);
+    CHECK(bus.filters.len == 0);
+    canopen.filter();
+    CHECK(bus.filters.len == 3);
+    // kept up to date
+    canopen.registerPDO(&a.tpdo[1], &a);
+    REQUIRE(bus.filters.len == 4);
+    auto matches = [&](uint32_t id, bool ide) {
+        for (auto &f : bus.filters) {
+            if ((id & f.mask) == (f.id & f.mask) && f.ide == ide) return true;
+        }
+        return false;
+    };
+    CHECK(matches(0x583, false));
+    CHECK(matches(0x703, false));
+    CHECK(matches(0x183, false));
+    CHECK(matches(0x1000003, true));
+    CHECK_FALSE(matches(0x584, false));
+    CHECK_FALSE(matches(0x183, true));
+    CHECK_FALSE(matches(0x603, false));
+
+    k.tick(5);
+    bus.rx.push({.data = 0x05, .id = 0x703, .opts = {.dlc = 1}});
+    canopen.process();
+    CHECK(canopen.states[3] == Open::STATE::OPERATIONAL);
+    CHECK(canopen.alive[3] == k.time);
+    // 29-bit identifiers are no heartbeats
+    CHECK_FALSE(canopen.handleHeartbeat({.data = 0x04, .id = 0x703,
+                .opts = {.ide = 1, .dlc = 1}}));
+    CHECK(canopen.states[3] == Open::STATE::OPERATIONAL);
+}
+TEST_CASE("tool-libs: canopen: can fd pdo") {
+    CHECK(dlcOf(0) == 0);
+    CHECK(dlcOf(8) == 8);
+    CHECK(dlcOf(9) == 9);
+    CHECK(dlcOf(13) == 10);
+    CHECK(dlcOf(64) == 15);
+    CHECK(lenOf(15) == 64);
+    CHECK(lenOf(15, false) == 8);
+
+    Open::RPDO out{.N = 1, .type = Open::SYNC, .COB = 0x201,
+        .map = Buffer<Open::PDOMap>(20), .brs = true};
+    Open::TPDO in{.N = 1, .type = Open::SYNC, .COB = 0x201,
+        .map = Buffer<Open::PDOMap>(20)};
+    for (int i = 0; i < 20; ++i) {
+        uint8_t len = i % 3 == 0 ? 32 : i % 3 == 1 ? 16 : 4;
+        out.map.append({.ix = 0x6000, .sub = (uint8_t)i, .len = len,
+                .data = (int32_t)(0x12345678 * (i + 1))});
+        in.map.append({.ix = 0x6000, .sub = (uint8_t)i, .len = len});
+    }
+    auto msg = out.toMessage();
+    CHECK(msg.opts.fdf);
+    CHECK(msg.opts.brs);
+    // 7 * 32 + 7 * 16 + 6 * 4 bits = 45 bytes
+    CHECK(msg.len() == 48);
+    in.receive(msg);
+    for (int i = 0; i < 20; ++i) {
+        uint8_t len = in.map[i].len;
+        uint32_t mask = len == 32 ? ~0U : (1U << len) - 1;
+        CHECK((uint32_t)in.map[i].data == ((uint32_t)out.map[i].data & mask));
+    }
+    // classic PDOs stay classic
+    out.map.len = 2;
+    msg = out.toMessage();
+    CHECK_FALSE(msg.opts.fdf);
+    CHECK(msg.opts.dlc == 6);
+    CHECK(msg.data == ((uint64_t)0x12345678 | (uint64_t)(0x2468acf0 & 0xffff) << 32));
+}
+/** minimal SDO server of a single object, cf. CiA 301 */
+struct Server {
+    Bus &bus;
+    uint8_t node;
+    Buffer<uint8_t> obj = 1024;
+    /** drop this block segment once */
+    uint8_t lose{};
+    enum { IDLE, DL_SEG, UL_SEG, BD, BD_END, BU_ACK, BU_END } phase{};
+    uint8_t toggle{}, seq{}, blksize{};
+    size_t off{}, blockStart{};
+    void reply(uint64_t raw) {
+        bus.rx.push({.data = raw, .id = 0x580U + node, .opts = {.dlc = 8}});
+    }
+    static uint8_t at(const Message &m, int i) { return m.data >> 8 * i; }
+    uint64_t segment(uint8_t cmd, size_t n) {
+        uint64_t raw = cmd;
+        for (size_t i = 0; i < n; ++i) raw |= (uint64_t)obj.buf[off + i] << 8 * (i + 1);
+        return raw;
+    }
+    void sendBlock() {
+        blockStart = off;
+        for (seq = 1; seq <= blksize && off < obj.len; ++seq) {
+            size_t n = obj.len - off < 7 ? obj.len - off : 7;
+            uint64_t raw = segment((off + n == obj.len) << 7 | seq, n);
+            off += n;
+            if (seq == lose) {
+                lose = 0;
+                continue;
+            }
+            reply(raw);
+        }
+    }
+    void handle(const Message &m) {
+        uint8_t cmd = m.data;
+        uint64_t mux = m.data & 0xffffff00;
+        if (cmd == 0x80) {
+            phase = IDLE;
+            return;
+        }
+        if (phase == BD && cmd != 0x80) {
+            uint8_t n = cmd & 0x7f;
+            bool inseq = n == seq + 1;
+            if (inseq && n != lose) {
+                seq++;
+                for (int i = 1; i < 8; ++i) obj.buf[obj.len++] = at(m, i);
+            } else if (n == lose) {
+                lose = 0;
+            }
+            if (n == blksize || cmd & 0x80) {
+                reply(0xa2 | seq << 8 | (uint64_t)blksize << 16);
+                if (inseq && cmd & 0x80) phase = BD_END;
+                seq = 0;
+            }
+            return;
+        }
+        bool initiate = cmd == 0x21 || cmd == 0x40 || cmd == 0xc6
+            || cmd == 0xa4 || (cmd & 0xe3) == 0x23;
+        if (initiate && (m.data >> 8 & 0xffff) != 0x2000) {
+            reply(0x80 | mux | (uint64_t)0x06020000 << 32);
+            return;
+        }
+        switch (cmd) {
+        case 0x21:
+            obj.len = 0;
+            toggle = 0;
+            phase = DL_SEG;
+            return reply(0x60 | mux);
+        case 0x40:
+            if (obj.len <= 4) {
+                uint64_t raw = 0x43 | (4 - obj.len) << 2 | mux;
+                for (size_t i = 0; i < obj.len; ++i) raw |= (uint64_t)obj.buf[i] << 8 * (4 + i);
+                return reply(raw);
+            }
+            phase = UL_SEG;
+            off = 0;
+            return reply(0x41 | mux | (uint64_t)obj.len << 32);
+        case 0xc6:
+            obj.len = 0;
+            seq = 0;
+            blksize = 10;
+            phase = BD;
+            return reply(0xa4 | mux | (uint64_t)blksize << 32);
+        case 0xa4:
+            blksize = at(m, 4);
+            off = 0;
+            return reply(0xc6 | mux | (uint64_t)obj.len << 32);
+        }
+        if ((cmd & 0xe3) == 0x23) {
+            obj.len = 4 - (cmd >> 2 & 3);
+            for (size_t i = 0; i < obj.len; ++i) obj.buf[i] = at(m, 4 + i);
+            return reply(0x60 | mux);
+        }
+        if (phase == DL_SEG && (cmd & 0xe0) == 0) {
+            CHECK((cmd >> 4 & 1) == toggle);
+            for (int i = 0; i < 7 - (cmd >> 1 & 7); ++i) obj.buf[obj.len++] = at(m, i + 1);
+            reply(0x20 | toggle << 4);
+            toggle ^= 1;
+            if (cmd & 1) phase = IDLE;
+            return;
+        }
+        if (phase == UL_SEG && (cmd & 0xe0) == 0x60) {
+            size_t n = obj.len - off < 7 ? obj.len - off : 7;
+            bool last = off + n == obj.len;
+            reply(segment((cmd & 0x10) | (7 - n) << 1 | last, n));
+            off += n;
+            if (last) phase = IDLE;
+            return;
+        }
+        if (phase == BD_END && (cmd & 0xe3) == 0xc1) {
+            obj.len -= cmd >> 2 & 7;
+            CHECK((uint16_t)(m.data >> 8) == Open::crc16(obj.buf, obj.len));
+            phase = IDLE;
+            return reply(0xa1);
+        }
+        if (cmd == 0xa3) {
+            phase = BU_ACK;
+            return sendBlock();
+        }
+        if (phase == BU_ACK && cmd == 0xa2) {
+            off = blockStart + at(m, 1) * 7;
+            if (off > obj.len) off = obj.len;
+            blksize = at(m, 2);
+            if (off < obj.len) return sendBlock();
+            size_t last = obj.len - (obj.len - 1) / 7 * 7;
+            phase = BU_END;
+            return reply(0xc1 | (7 - last) << 2 | (uint64_t)Open::crc16(obj.buf, obj.len) << 8);
+        }
+        if (phase == BU_END && cmd == 0xa1) {
+            phase = IDLE;
+            return;
+        }
+        CHECK(!"unexpected SDO command");
+    }
+};
+
+struct Client : Open::Device {
+    Client(Open::Dispatch &d) : Device(d, 5) { }
+    Queue<Open::Transfer> done{8};
+    size_t sdos{};
+    void callback(Open::SDO) override { sdos++; }
+    void completed(Open::Transfer &&t) override { done.push(std::move(t)); }
+};
+
+TEST_CASE("tool-libs: canopen: sdo transfers") {
+    Bus bus;
+    Open::Dispatch canopen{bus};
+    Client dev{canopen};
+    Server srv{bus, 5};
+    auto run = [&]() {
+        for (int i = 0; i < 1000 && !bus.tx.empty(); ++i) {
+            while (!bus.tx.empty()) srv.handle(bus.tx.pop());
+            canopen.process();
+            dev.poll(0, 0);
+        }
+        REQUIRE(dev.done.size() == 1);
+        return dev.done.pop();
+    };
+    Buffer<uint8_t> data = 300;
+    for (int i = 0; i < 300; ++i) data.append(i * 7);
+    auto same = [&](const Buffer<uint8_t> &a, const Buffer<uint8_t> &b) {
+        REQUIRE(a.len == b.len);
+        for (size_t i = 0; i < a.len; ++i) CHECK(a.buf[i] == b.buf[i]);
+    };
+    for (bool block : {false, true}) {
+        for (size_t len : {3, 7, 100, 300}) {
+            Buffer<uint8_t> d = data;
+            d.len = len;
+            srv.lose = block ? 3 : 0;
+            dev.download(0x2000, 1, Buffer<uint8_t>(d), block);
+            auto t = run();
+            CHECK(t.abort == 0);
+            CHECK(t.kind == Open::Transfer::DOWNLOAD);
+            same(srv.obj, d);
+
+            srv.lose = block ? 2 : 0;
+            dev.upload(0x2000, 1, block);
+            t = run();
+            CHECK(t.abort == 0);
+            same(t.data, d);
+        }
+    }
+    SUBCASE("abort") {
+        dev.upload(0x3000, 1);
+        auto t = run();
+        CHECK(t.abort == 0x06020000);
+    }
+    SUBCASE("uploads longer than maxlen") {
+        srv.obj = data;
+        dev.maxlen = 100;
+        for (bool block : {false, true}) {
+            dev.upload(0x2000, 1, block);
+            auto t = run();
+            CHECK(t.abort == 0x05040005);
+            CHECK(t.data.size <= 100 + 7);
+        }
+        dev.maxlen = 300;
+        dev.upload(0x2000, 1, true);
+        CHECK(run().data.len == 300);
+    }
+    SUBCASE("late response is no init ack") {
+        dev.download(0x2000, 1, Buffer<uint8_t>(data));
+        bus.rx.push({.data = 0x02200060, .id = 0x585, .opts = {.dlc = 8}});
+        canopen.process();
+        CHECK(dev.done.empty());
+        auto t = run();
+        CHECK(t.abort == 0);
+        same(srv.obj, data);
+    }
+    SUBCASE("empty download") {
+        srv.obj.len = 3;
+        dev.download(0x2000, 1, Buffer<uint8_t>{});
+        CHECK(bus.tx.front().data == 0x01200021);
+        CHECK(run().abort == 0);
+        CHECK(srv.obj.len == 0);
+    }
+    SUBCASE("transfers beyond the queue are aborted") {
+        for (int i = 0; i < 6; ++i) dev.upload(0x2000, 1);
+        REQUIRE(dev.done.size() == 1);
+        CHECK(dev.done.pop().abort == 0x05040005);
+        while (!bus.tx.empty()) {
+            srv.handle(bus.tx.pop());
+            canopen.process();
+            dev.poll(0, 0);
+        }
+        REQUIRE(dev.done.size() == 5);
+        while (!dev.done.empty()) CHECK(dev.done.pop().abort == 0);
+    }
+    SUBCASE("expedited requests wait for running transfer") {
+        dev.download(0x2000, 1, Buffer<uint8_t>(data), true);
+        dev.w32(0x2000, 2, 1);
+        CHECK(bus.tx.size() == 1);
+        CHECK(run().abort == 0);
+        // sent and answered after the transfer
+        CHECK(dev.sdos == 1);
+        CHECK(dev.done.empty());
+    }
+}
+struct Acks : Open::Device {
+    Acks(Open::Dispatch &d, uint8_t id) : Device(d, id) { }
+    Queue<Open::SDO> got{64};
+    void callback(Open::SDO rq) override { got.push(std::move(rq)); }
+};
+
+TEST_CASE("tool-libs: canopen: pipelined sdo client") {
+    Bus bus;
+    Open::Dispatch canopen{bus};
+    Acks a{canopen, 1}, b{canopen, 2};
+    size_t drop = 0, sent = 0;
+    // answer every request at once, unless dropped
+    auto serve = [&]() {
+        while (!bus.tx.empty()) {
+            auto m = bus.tx.pop();
+            sent++;
+            if (drop && drop--) continue;
+            uint64_t mux = m.data & 0xffffff00;
+            uint8_t cmd = m.data;
+            bus.rx.push({.data = (cmd == 0x40 ? 0x4f | (uint64_t)0x42 << 32 : 0x60) | mux,
+                    .id = m.id - 0x600 + 0x580, .opts = {.dlc = 8}});
+        }
+        canopen.process();
+    };
+    SUBCASE("next request on response") {
+        Open::TPDO pdo{.N = 1, .type = Open::SYNC, .map = {
+            {.ix = 0x6064, .len = 32}, {.ix = 0x606c, .len = 32}}};
+        Open::TPDO pdo2 = pdo;
+        a.enablePDO(pdo);
+        b.enablePDO(pdo2);
+        // one request per node in flight
+        CHECK(bus.tx.size() == 2);
+        uint32_t start = k.time;
+        for (int i = 0; i < 20 && !bus.tx.empty(); ++i) serve();
+        CHECK(k.time == start);
+        CHECK(a.got.size() == 8);
+        CHECK(b.got.size() == 8);
+        CHECK(a.got.front().ix == 0x1800);
+        CHECK(a.got.front().sub == 0x1);
+        CHECK(a.got.getAt(7).ix == 0x1800);
+        CHECK(a.got.getAt(7).data == 0);
+    }
+    SUBCASE("retransmit on timeout") {
+        drop = 1;
+        a.read(0x2000, 1);
+        a.w8(0x2000, 2, 1);
+        serve();
+        CHECK(a.got.empty());
+        k.tick(a.timeout);
+        a.poll(k.time, 0);
+        // the write follows on the response to the read
+        serve();
+        serve();
+        REQUIRE(a.got.size() == 2);
+        CHECK(a.got.front().cmd == 0x4f);
+        CHECK(a.got.front().data == 0x42);
+        CHECK(sent == 3);
+    }
+    SUBCASE("give up after retries") {
+        drop = 100;
+        a.read(0x2000, 1);
+        for (int i = 0; i <= a.retries; ++i) {
+            serve();
+            k.tick(a.timeout);
+            a.poll(k.time, 0);
+        }
+        REQUIRE(a.got.size() == 1);
+        CHECK(a.got.front().cmd == 0x80);
+        CHECK(a.got.front().data == 0x05040000);
+        CHECK(sent == 1U + a.retries);
+    }
+    SUBCASE("late responses are dropped") {
+        a.read(0x2000, 1);
+        bus.tx.pop();
+        bus.rx.push({.data = 0x60 | 0x3000 << 8, .id = 0x581, .opts = {.dlc = 8}});
+        canopen.process();
+        CHECK(a.got.empty());
+        bus.rx.push({.data = 0x4f | 0x2000 << 8 | 1 << 24, .id = 0x581, .opts = {.dlc = 8}});
+        canopen.process();
+        CHECK(a.got.size() == 1);
+    }
+}
@@ -0,0 +1,80 @@
+#include <doctest/doctest.h>
+#include <utils/queue.h>
+#include <comm/bufferutils.h>
+
+TEST_CASE("tool-libs: coalesce: merge up to mtu") {
+    Queue<Buffer<uint8_t>> q{8};
+    Coalesce co{q, 8, 2};
+    co.push(Buffer<uint8_t>{1, 2, 3});
+    co.push(Buffer<uint8_t>{4, 5, 6});
+    CHECK(q.empty());
+    co.push(Buffer<uint8_t>{7, 8, 9});
+    REQUIRE(q.size() == 1);
+    auto b = q.pop();
+    CHECK(b.len == 6);
+    for (size_t i = 0; i < b.len; ++i) CHECK(b[i] == i + 1);
+    co.push(Buffer<uint8_t>{10, 11, 12, 13, 14});
+    REQUIRE(q.size() == 1);
+    CHECK(q.pop().len == 8);
+
+    SUBCASE("large buffers pass through") {
+        co.push(Buffer<uint8_t>{1});
+        Buffer<uint8_t> big = 20;
+        big.len = 20;
+        co.push(std::move(big));
+        REQUIRE(q.size() == 2);
+        CHECK(q.pop().len == 1);
+        CHECK(q.pop().len == 20);
+    }
+    SUBCASE("large buffer waits if the flush filled the sink") {
+        Queue<Buffer<uint8_t>> one{1};
+        Coalesce co{one, 8, 2};
+        co.push(Buffer<uint8_t>{1});
+        Buffer<uint8_t> big = 20;
+        big.len = 20;
+        co.push(std::move(big));
+        REQUIRE(one.full());
+        CHECK(one.pop().len == 1);
+        co.poll(2, 2);
+        REQUIRE(one.full());
+        CHECK(one.pop().len == 20);
+    }
+}
+TEST_CASE("tool-libs: coalesce: hold time") {
+    Queue<Buffer<uint8_t>> q{8};
+    Coalesce co{q, 64, 2};
+    co.poll(10, 1);
+    co.push(Buffer<uint8_t>{1, 2});
+    co.poll(11, 1);
+    CHECK(q.empty());
+    co.push(Buffer<uint8_t>{3});
+    co.poll(12, 1);
+    REQUIRE(q.size() == 1);
+    CHECK(q.pop().len == 3);
+    co.poll(20, 1);
+    CHECK(q.empty());
+
+    SUBCASE("no hold") {
+        Coalesce now{q, 64, 0};
+        now.push(Buffer<uint8_t>{1, 2});
+        now.push(Buffer<uint8_t>{3});
+        now.poll(21, 1);
+        REQUIRE(q.size() == 1);
+        CHECK(q.pop().len == 3);
+    }
+    SUBCASE("full sink keeps data pending") {
+        Queue<Buffer<uint8_t>> one{1};
+        Coalesce co{one, 64, 2};
+        one.push(Buffer<uint8_t>{0});
+        co.poll(30, 1);
+        co.push(Buffer<uint8_t>{1, 2});
+        co.poll(32, 1);
+        CHECK(one.pop().len == 1);
+        CHECK(one.empty());
+        co.poll(33, 1);
+        REQUIRE(one.full());
+        auto b = one.pop();
+        CHECK(b.len == 2);
+        CHECK(b[1] == 2);
+    }
+}
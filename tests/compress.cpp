@@ -0,0 +1,141 @@
+#include <cmath>
+#include <comm/compress.h>
+#include <doctest/doctest.h>
+
+/** telemetry like Frame: slowly varying doubles, counter, flag */
+Frame sample(uint8_t id, uint32_t t) {
+    Frame f{id};
+    f.pack<double>(sin(t * 1e-3))
+        .pack<double>(cos(t * 1e-3))
+        .pack<double>(42.0)
+        .pack<uint32_t>(t)
+        .pack<uint8_t>(1);
+    return f;
+}
+
+bool same(Frame &a, Frame &b) {
+    if (a.id != b.id || a.b.len != b.b.len) return false;
+    return memcmp(a.b.buf, b.b.buf, a.b.len) == 0;
+}
+
+TEST_CASE("tool-libs: compress: pack / unpack roundtrip") {
+    uint8_t in[19]{1, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 3, 0, 4};
+    uint8_t packed[32], out[19];
+    size_t len = Compress::Codec::pack(in, sizeof(in), packed);
+    CHECK(len == 3 + 1 + 3);
+    CHECK(Compress::Codec::unpack(packed, len, out, sizeof(out)));
+    CHECK(memcmp(in, out, sizeof(in)) == 0);
+    CHECK_FALSE(Compress::Codec::unpack(packed, len - 1, out, sizeof(out)));
+}
+
+TEST_CASE("tool-libs: compress: roundtrip") {
+    Queue<Frame> link{100};
+    Compress tx{link, link}, rx{link, link};
+    tx.enable(true);
+    rx.enable(true);
+    size_t raw{}, compressed{};
+    for (uint32_t t = 0; t < 40; ++t) {
+        Frame f = sample(t % 2 + 1, t);
+        raw += f.b.len;
+        tx.out.push(f);
+        Frame c = link.pop();
+        compressed += c.b.len;
+        CHECK(c.id == f.id);
+        link.push(std::move(c));
+        REQUIRE_FALSE(rx.in.empty());
+        Frame d = rx.in.pop();
+        CHECK(same(f, d));
+    }
+    CHECK(compressed < raw);
+    CHECK(rx.in.dropped == 0);
+}
+
+TEST_CASE("tool-libs: compress: lost frame") {
+    Queue<Frame> link{100};
+    Compress tx{link, link}, rx{link, link};
+    tx.enable(true);
+    rx.enable(true);
+    tx.out.keyframe = 4;
+    for (uint32_t t = 0; t < 8; ++t) {
+        tx.out.push(sample(1, t));
+        Frame c = link.pop();
+        if (t == 1) continue;
+        link.push(std::move(c));
+        bool got = !rx.in.empty();
+        if (got) rx.in.pop();
+        // frames 2, 3 reference the lost one
+        CHECK(got == (t < 1 || t > 3));
+    }
+    CHECK(rx.in.dropped == 2);
+}
+
+TEST_CASE("tool-libs: compress: negotiation") {
+    Queue<Frame> link{10};
+    FrameRegistry reg;
+    Compress zip{link, link};
+    zip.registerWith(reg, 62);
+
+    Frame f = sample(1, 0);
+    zip.out.push(f);
+    CHECK(same(f, link.front()));
+    link.pop();
+
+    Frame on{62};
+    on.pack<uint8_t>(1);
+    reg.handle(std::move(on));
+    REQUIRE_FALSE(link.empty());
+    Frame ack = link.pop();
+    CHECK(ack.id == 62);
+    CHECK(ack.unpack<uint8_t>() == (Compress::ACK | 1));
+    zip.out.push(f);
+    CHECK(link.pop().b.len < f.b.len);
+
+    SUBCASE("answers are not answered") {
+        Frame peer{62};
+        peer.pack<uint8_t>(Compress::ACK | 1);
+        reg.handle(std::move(peer));
+        CHECK(link.empty());
+        CHECK(zip.out.enabled);
+    }
+}
+
+TEST_CASE("tool-libs: compress: transport frame limit") {
+    Queue<Frame> link{10};
+    Compress tx{link, link}, rx{link, link};
+    tx.enable(true);
+    rx.enable(true);
+    auto frame = [](size_t n, bool noisy) {
+        Frame f{1};
+        f.b = Buffer<uint8_t>(256);
+        for (size_t i = 0; i < n; ++i) f.b.buf[i] = noisy ? i * 7 + 1 : i % 9 == 0;
+        f.b.len = n;
+        return f;
+    };
+    auto roundtrip = [&](Frame f) {
+        tx.out.push(f);
+        if (link.empty()) return false;
+        CHECK(link.front().b.len <= Compress::MAXLEN);
+        REQUIRE_FALSE(rx.in.empty());
+        Frame d = rx.in.pop();
+        return same(f, d);
+    };
+    CHECK(roundtrip(frame(253, true)));
+    CHECK(roundtrip(frame(255, false)));
+    CHECK(roundtrip(frame(255, false)));
+    CHECK_FALSE(roundtrip(frame(255, true)));
+    CHECK(tx.out.dropped == 1);
+    // the dropped Frame does not break the reference of the next
+    CHECK(roundtrip(frame(255, false)));
+    CHECK(rx.in.dropped == 0);
+}
+
+TEST_CASE("tool-libs: compress: no keyframes") {
+    Queue<Frame> link{10};
+    Compress tx{link, link};
+    tx.enable(true);
+    tx.out.keyframe = 0;
+    for (uint32_t t = 0; t < 4; ++t) {
+        tx.out.push(sample(1, t));
+        CHECK(link.pop().b[0] == (t ? Compress::DELTA : Compress::KEY));
+    }
+}
@@ -0,0 +1,76 @@
+#include <doctest/doctest.h>
+#include <comm/crc.h>
+
+template<typename Engine>
+uint32_t crc(const uint8_t *p, size_t n) {
+    BasicCRC32<Engine> c;
+    c.update(p, n);
+    return c.finalize();
+}
+
+TEST_CASE("tool-libs: crc: check value") {
+    const uint8_t check[] = "123456789";
+    CHECK(crc<CRC::Bitwise>(check, 9) == 0xcbf43926);
+    CHECK(crc<CRC::Nibble>(check, 9) == 0xcbf43926);
+    CHECK(crc<CRC::Slice8>(check, 9) == 0xcbf43926);
+}
+
+TEST_CASE("tool-libs: crc: engines match bitwise reference") {
+    uint8_t data[1024];
+    uint32_t x = 1;
+    for (auto &d : data) {
+        x = x * 1664525 + 1013904223;
+        d = x >> 24;
+    }
+    for (size_t off = 0; off < 9; ++off) {
+        for (size_t n : {0, 1, 7, 8, 9, 63, 64, 65, 1000}) {
+            uint32_t ref = crc<CRC::Bitwise>(data + off, n);
+            CHECK(crc<CRC::Nibble>(data + off, n) == ref);
+            CHECK(crc<CRC::Slice8>(data + off, n) == ref);
+        }
+    }
+    SUBCASE("bytewise steps match bulk update") {
+        CRC32 a, b;
+        for (size_t i = 0; i < 100; ++i) a.step(data[i]);
+        b.update(data, 100);
+        CHECK(a.finalize() == b.finalize());
+        CHECK(a.finalize() == crc<CRC::Bitwise>(data, 100));
+    }
+}
+
+/** software model of the STM32 CRC unit as set up in stm/crc.cpp */
+struct StmUnit {
+    uint32_t crc;
+    static uint32_t rbit(uint32_t x, int bits) {
+        uint32_t r = 0;
+        for (int i = 0; i < bits; ++i, x >>= 1) r = r << 1 | (x & 1);
+        return r;
+    }
+    void shift(uint32_t data, int bits) {
+        crc ^= data;
+        for (int i = 0; i < bits; ++i) {
+            crc = crc & 0x80000000 ? crc << 1 ^ 0x04c11db7 : crc << 1;
+        }
+    }
+    void word(uint32_t w) {
+        uint32_t r = 0;
+        for (int i = 0; i < 32; i += 8) r |= rbit(w >> i & 0xff, 8) << i;
+        shift(r, 32);
+    }
+    void byte(uint8_t b) { shift(rbit(b, 8) << 24, 8); }
+    static uint32_t update(uint32_t crc, const uint8_t *p, size_t n) {
+        StmUnit unit{rbit(crc, 32)};
+        CRC::feed(unit, p, n);
+        return rbit(unit.crc, 32);
+    }
+};
+
+TEST_CASE("tool-libs: crc: word fed hardware unit matches software") {
+    uint8_t data[64];
+    for (size_t i = 0; i < sizeof(data); ++i) data[i] = i * 37 + 11;
+    for (size_t n : {0, 1, 3, 4, 5, 8, 9, 63, 64}) {
+        CHECK(crc<StmUnit>(data, n) == crc<CRC::Bitwise>(data, n));
+    }
+    const uint8_t check[] = "123456789";
+    CHECK(crc<StmUnit>(check, 9) == 0xcbf43926);
+}
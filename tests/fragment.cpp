@@ -0,0 +1,95 @@
+#include <doctest/doctest.h>
+#include <comm/fragment.h>
+#include <comm/min.h>
+
+TEST_CASE("tool-libs: fragment: roundtrip through Min") {
+    Queue<Buffer<uint8_t>> wire{64};
+    Min min{.in=wire, .out=wire};
+    Fragment::Out up{min.out, 60, 2};
+    Fragment::In down;
+    down.registerWith(min.reg, 60);
+    size_t beats = 0;
+    min.reg.setHandler(2, [](Frame &) { });
+
+    Buffer<uint8_t> big = 1000, small = 10;
+    for (size_t i = 0; i < big.size; ++i) big.append(i * 13);
+    for (size_t i = 0; i < small.size; ++i) small.append(i);
+    up.push(Fragment::Message{1, big});
+    up.push(Fragment::Message{2, small});
+    for (uint32_t t = 0; t < 10 && !up.idle(); ++t) {
+        // heartbeat goes out between fragments
+        min.out.push(Frame{2});
+        up.poll(t, 1);
+        beats++;
+        min.poll(t, 1);
+    }
+    CHECK(beats == 3);
+    REQUIRE_FALSE(down.empty());
+    auto m = down.pop();
+    CHECK(m.id == 1);
+    REQUIRE(m.data.len == big.len);
+    CHECK(memcmp(m.data.buf, big.buf, big.len) == 0);
+    REQUIRE_FALSE(down.empty());
+    m = down.pop();
+    CHECK(m.id == 2);
+    CHECK(m.data.len == small.len);
+    CHECK(down.lost == 0);
+}
+
+TEST_CASE("tool-libs: fragment: lost fragment, preallocated destination") {
+    Queue<Frame> link{16};
+    Fragment::Out up{link, 60, 16};
+    Fragment::In down;
+    Buffer<uint8_t> dst = 2000;
+    const uint8_t *mem = dst.buf;
+    down.reserve(3, std::move(dst));
+
+    Buffer<uint8_t> big = 600;
+    big.len = big.size;
+    up.push(Fragment::Message{3, big});
+    up.poll(0, 1);
+    REQUIRE(link.size() == 3);
+    link.drop();
+    while (!link.empty()) down.handleFrame(link.front()), link.drop();
+    CHECK(down.empty());
+    CHECK(down.lost == 1);
+
+    up.push(Fragment::Message{3, big});
+    up.poll(1, 1);
+    while (!link.empty()) down.handleFrame(link.front()), link.drop();
+    REQUIRE_FALSE(down.empty());
+    auto m = down.pop();
+    CHECK(m.data.len == 600);
+    CHECK(m.data.buf == mem);
+}
+
+TEST_CASE("tool-libs: fragment: limits") {
+    Queue<Frame> link{32};
+    Fragment::Out up{link, 60, 32};
+    Buffer<uint8_t> big = 600;
+    big.len = big.size;
+    SUBCASE("messages exceeding maxlen are not allocated") {
+        Fragment::In down{4, 500};
+        up.push(Fragment::Message{1, big});
+        up.poll(0, 1);
+        while (!link.empty()) down.handleFrame(link.front()), link.drop();
+        CHECK(down.empty());
+        CHECK(down.lost == 1);
+        // unless a destination is reserved
+        down.reserve(1, Buffer<uint8_t>(600));
+        up.push(Fragment::Message{1, big});
+        up.poll(1, 1);
+        while (!link.empty()) down.handleFrame(link.front()), link.drop();
+        CHECK_FALSE(down.empty());
+        CHECK(down.lost == 1);
+    }
+    SUBCASE("finished messages without room are counted") {
+        Fragment::In down{1};
+        up.push(Fragment::Message{1, big});
+        up.push(Fragment::Message{2, big});
+        up.poll(0, 1);
+        while (!link.empty()) down.handleFrame(link.front()), link.drop();
+        CHECK(down.lost == 1);
+        CHECK(down.pop().id == 1);
+    }
+}
@@ -45,3 +45,36 @@ TEST_CASE("tool-libs: frame registry:") {
     reg.handle(std::move(f));
     reg.handle(std::move(g));
 }
+TEST_CASE("tool-libs: frame registry: multiple subscribers") {
+    FrameRegistry reg;
+    static Exp exp;
+    static int seen;
+    seen = 0;
+    reg.subscribe(10, exp, &Exp::getPi);
+    reg.subscribe(10, [](Frame &f) {
+        // every subscriber unpacks from the start
+        CHECK(f.unpack<double>() == doctest::Approx(3.14));
+        seen++;
+    });
+    Frame f{10};
+    f.pack(3.14);
+    reg.handle(std::move(f));
+    CHECK(seen == 1);
+}
+TEST_CASE("tool-libs: frame registry: deferred ids") {
+    FrameRegistry reg;
+    static int bulk, control;
+    bulk = control = 0;
+    reg.subscribe(40, [](Frame &) { bulk++; });
+    reg.subscribe(1, [](Frame &) { control++; });
+    reg.defer(40, 4);
+    for (int i = 0; i < 6; ++i) reg.handle(Frame{40});
+    reg.handle(Frame{1});
+    CHECK(control == 1);
+    CHECK(bulk == 0);
+    CHECK(reg.dispatch(3) == 3);
+    CHECK(bulk == 3);
+    reg.poll(0, 0);
+    // queue overflowed
+    CHECK(bulk == 4);
+}
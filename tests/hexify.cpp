@@ -0,0 +1,81 @@
+#include <doctest/doctest.h>
+#include <utils/queue.h>
+#include <comm/bufferutils.h>
+#include <comm/min.h>
+
+TEST_CASE("tool-libs: hexify: encode") {
+    Queue<Buffer<uint8_t>> q{4};
+    Hexify hex{q};
+    hex.push(Buffer<uint8_t>{0x00, 0xaa, 0x5f});
+    auto b = q.pop();
+    CHECK(b.len == 9);
+    CHECK(memcmp(b.buf, "\\00\\aa\\5f", 9) == 0);
+    SUBCASE("large buffers are chunked") {
+        Buffer<uint8_t> big = 1300;
+        for (size_t i = 0; i < big.size; ++i) big.append(i);
+        hex.push(std::move(big));
+        CHECK(q.size() == 3);
+        CHECK(q.pop().len == 3 * Hexify::chunk);
+        CHECK(q.pop().len == 3 * Hexify::chunk);
+        CHECK(q.pop().len == 3 * (1300 - 2 * Hexify::chunk));
+    }
+    SUBCASE("chunks stop at full downstream") {
+        Queue<Buffer<uint8_t>> small{2};
+        Hexify h{small};
+        Buffer<uint8_t> big = 1300;
+        big.len = big.size;
+        h.push(std::move(big));
+        CHECK(small.full());
+        CHECK(small.pop().len == 3 * Hexify::chunk);
+        CHECK(small.pop().len == 3 * Hexify::chunk);
+        CHECK(small.empty());
+    }
+}
+TEST_CASE("tool-libs: hexify: roundtrip") {
+    Queue<Buffer<uint8_t>> text{4};
+    Hexify hex{text};
+    Unhexify unhex{text};
+    Buffer<uint8_t> data = 700;
+    for (size_t i = 0; i < data.size; ++i) data.append(i * 7);
+    hex.push(data);
+    size_t ix = 0;
+    while (!unhex.empty()) {
+        for (auto c: unhex.pop()) CHECK(c == data.at(ix++));
+    }
+    CHECK(ix == data.len);
+}
+TEST_CASE("tool-libs: hexify: replay into min") {
+    Queue<Buffer<uint8_t>> text{4};
+    Unhexify unhex{text};
+    Min::In in{unhex};
+    const char dump[] =
+        "\\aa\\aa\\aa\\01\\0c\\1f\\85\\eb\\51\\b8\\1e\\09\\40\n"
+        "\\10\\0e\\00\\00\\13\\96\\30\\3c\\55\n";
+    // split in the middle of a byte
+    text.push(Buffer<uint8_t>{(const uint8_t *)dump, 20});
+    text.push(Buffer<uint8_t>{(const uint8_t *)dump + 20, sizeof dump - 21});
+    CHECK(!in.empty());
+    Frame f = in.pop();
+    CHECK(f.id == 1);
+    CHECK(f.unpack<double>() == 3.14);
+    CHECK(f.unpack<uint32_t>() == 3600);
+}
+TEST_CASE("tool-libs: hexify: batch stops at full downstream") {
+    Queue<Buffer<uint8_t>> q{2};
+    Hexify hex{q};
+    Buffer<uint8_t> in[5];
+    for (size_t i = 0; i < 5; ++i) {
+        in[i] = Buffer<uint8_t>(300);
+        in[i].len = 300;
+        memset(in[i].buf, i, 300);
+    }
+    // 300 bytes each, no two fit a chunk together
+    CHECK(hex.pushBatch(in, 5) == 2);
+    CHECK(q.pop().len == 900);
+    CHECK(q.pop().len == 900);
+    CHECK(hex.pushBatch(in + 2, 3) == 2);
+    CHECK(q.pop().buf[2] == '2');
+    CHECK(q.pop().buf[2] == '3');
+    CHECK(hex.pushBatch(in + 4, 1) == 1);
+    CHECK(q.pop().buf[2] == '4');
+}
@@ -0,0 +1,65 @@
+#include <doctest/doctest.h>
+#include <comm/line.h>
+
+Buffer<uint8_t> str(const char *s) {
+    return Buffer<uint8_t>{(const uint8_t *)s, strlen(s)};
+}
+bool is(const Buffer<uint8_t> &b, const char *s) {
+    return b.len == strlen(s) && memcmp(b.buf, s, b.len) == 0;
+}
+
+TEST_CASE("tool-libs: line: filter") {
+    Queue<Buffer<uint8_t>> q{5};
+    LineFilter lines{q, 16};
+    SUBCASE("split within and across buffers") {
+        q.push(str("first\r\nsecond line\nthi"));
+        q.push(str("rd line, long one"));
+        q.push(str("\r\rfourth"));
+        q.push(str("\n"));
+        CHECK(!lines.empty());
+        CHECK(is(lines.pop(), "first"));
+        CHECK(is(lines.pop(), "second line"));
+        CHECK(is(lines.pop(), "fourth"));
+        CHECK(lines.empty());
+        CHECK(lines.overlong == 1);
+    }
+    SUBCASE("single line buffers are passed on as is") {
+        auto b = str("hello\r\n");
+        auto p = b.buf;
+        q.push(std::move(b));
+        CHECK(!lines.empty());
+        auto l = lines.pop();
+        CHECK(l.buf == p);
+        CHECK(is(l, "hello"));
+    }
+    SUBCASE("overlong lines") {
+        q.push(str("this line is way too long\nok\n"));
+        q.push(str("0123456789abcdef"));
+        q.push(str("0\nalso ok\n"));
+        CHECK(!lines.empty());
+        CHECK(is(lines.pop(), "ok"));
+        CHECK(!lines.empty());
+        CHECK(is(lines.pop(), "also ok"));
+        CHECK(lines.overlong == 2);
+    }
+}
+TEST_CASE("tool-libs: line: find newline") {
+    const uint8_t s[] = "0123456789abcdefghij\rklmnop\n";
+    auto end = s + sizeof s - 1;
+    for (size_t i = 0; i < 20; ++i) {
+        CHECK(LineFilter::Stage::find(s + i, end) == s + 20);
+    }
+    CHECK(LineFilter::Stage::find(s + 21, end) == s + 27);
+    CHECK(LineFilter::Stage::find(s + 28, end) == end);
+}
+
+TEST_CASE("tool-libs: line: delimiter batch taken partially") {
+    Queue<Buffer<uint8_t>> q{2};
+    LineDelimiter delim{q};
+    Buffer<uint8_t> in[3] = {str("a"), str("b"), str("c")};
+    CHECK(delim.pushBatch(in, 3) == 2);
+    CHECK(is(q.pop(), "a\n"));
+    CHECK(delim.pushBatch(in + 2, 1) == 1);
+    CHECK(is(q.pop(), "b\n"));
+    CHECK(is(q.pop(), "c\n"));
+}
@@ -31,6 +31,109 @@ TEST_CASE("tool-libs: min: tx") {
     f.id=0x10;
     out.push(f);
 }
+TEST_CASE("tool-libs: min: batch") {
+    Queue<Buffer<uint8_t>> single{4}, batched{4};
+    Min::Out one{single}, all{batched};
+    Frame f[3]{1, 2, 3};
+    for (auto &fr : f) {
+        fr.pack(3.14);
+        fr.pack((uint32_t) 0xaaaaaaaa);
+        one.push(fr);
+    }
+    CHECK(all.pushBatch(f, 3) == 3);
+    CHECK(single.size() == 3);
+    CHECK(batched.size() == 1);
+    auto b = batched.pop();
+    size_t ix = 0;
+    while (!single.empty()) {
+        for (auto c : single.pop()) CHECK(c == b.at(ix++));
+    }
+    CHECK(ix == b.len);
+
+    batched.push(std::move(b));
+    Min::In in{batched};
+    Frame got[4];
+    CHECK(in.popBatch(got, 4) == 3);
+    for (int i = 0; i < 3; ++i) {
+        CHECK(got[i].id == i + 1);
+        CHECK(got[i].unpack<double>() == 3.14);
+        CHECK(got[i].unpack<uint32_t>() == 0xaaaaaaaa);
+    }
+}
+TEST_CASE("tool-libs: min: priority lanes") {
+    Queue<Buffer<uint8_t>> wire{64};
+    Min::Out out{wire};
+    // 10 bytes per ms, 40 bytes burst
+    out.shape(10000, 8, 40);
+    out.priority(40, Min::Out::BULK);
+    out.priority(1, Min::Out::CONTROL);
+    for (int i = 0; i < 8; ++i) {
+        Frame bulk{40};
+        for (int j = 0; j < 12; ++j) bulk.pack<uint32_t>(j);
+        out.push(std::move(bulk));
+    }
+    // a full BULK lane holds back nothing else
+    CHECK_FALSE(out.full());
+    CHECK(out.full(40));
+    CHECK_FALSE(out.full(2));
+    Frame extra{40};
+    CHECK(out.pushBatch(&extra, 1) == 0);
+    out.trypush(Frame{40});
+    CHECK(out.dropped == 1);
+    out.trypush(Frame{2});
+    out.trypush(Frame{1});
+    CHECK(wire.empty());
+    out.poll(0, 0);
+    Min::In in{wire};
+    REQUIRE_FALSE(in.empty());
+    CHECK(in.pop().id == 1);
+    CHECK(in.pop().id == 2);
+    size_t bulk = 0;
+    while (!in.empty()) bulk += in.pop().id == 40;
+    // first bulk Frame exceeds the remaining tokens
+    CHECK(bulk == 1);
+    size_t sent = 0;
+    for (uint32_t t = 1; t <= 100 && bulk + sent < 8; ++t) {
+        out.poll(t, 1);
+        while (!in.empty()) {
+            CHECK(in.pop().id == 40);
+            sent++;
+        }
+    }
+    CHECK(bulk + sent == 8);
+}
+TEST_CASE("tool-libs: min: batched out") {
+    Queue<Buffer<uint8_t>> single{8}, batched{8};
+    Min::Out one{single}, all{batched, 256};
+    Frame big{7};
+    big.b = Buffer<uint8_t>(200);
+    for (int i = 0; i < 199; ++i) big.pack<uint8_t>(0xaa);
+    Frame f[4]{1, 2, big, 3};
+    for (auto &fr : f) {
+        one.push(fr);
+        all.push(fr);
+    }
+    // stuffed Frame larger than the batch gets its own Buffer
+    CHECK(batched.size() == 2);
+    all.flush();
+    CHECK(batched.size() == 3);
+    all.flush();
+    CHECK(batched.size() == 3);
+    Buffer<uint8_t> joined = 1024;
+    while (!batched.empty()) for (auto c : batched.pop()) joined.append(c);
+    size_t ix = 0;
+    while (!single.empty()) {
+        for (auto c : single.pop()) CHECK(c == joined.at(ix++));
+    }
+    CHECK(ix == joined.len);
+
+    batched.push(std::move(joined));
+    Min::In in{batched};
+    Frame got[4];
+    REQUIRE(in.popBatch(got, 4) == 4);
+    CHECK(got[2].id == 7);
+    CHECK(got[2].b.len == 199);
+}
 TEST_CASE("tool-libs: min: rx") {
     Queue<Buffer<uint8_t>> q{2};
     Min min{.in=q, .out=hex};
@@ -67,6 +170,41 @@ TEST_CASE("tool-libs: min: rx") {
     }
     CHECK(i == 2);
 }
+TEST_CASE("tool-libs: min: rx split at every position") {
+    // garbage, stuffed payload, oversized payload, corrupted frame
+    Queue<Buffer<uint8_t>> wire{4};
+    Min::Out out{wire};
+    Frame a{1}, b{2}, c{3};
+    b.b = Buffer<uint8_t>(200);
+    for (int i = 0; i < 20; ++i) a.pack<uint8_t>(i % 3 ? 0xaa : i);
+    for (int i = 0; i < 40; ++i) b.pack<uint32_t>(0xaaaa55aa);
+    c.pack<double>(3.14);
+    out.pushBatch(&a, 1);
+    out.pushBatch(&b, 1);
+    out.pushBatch(&c, 1);
+    Buffer<uint8_t> stream = 512;
+    for (uint8_t g : {0x00, 0xaa, 0x55, 0x12}) stream.append(g);
+    while (!wire.empty()) {
+        auto one = wire.pop();
+        if (wire.size() == 0) one[one.len / 2] ^= 0xff;
+        for (auto x : one) stream.append(x);
+    }
+    for (size_t split = 0; split <= stream.len; ++split) {
+        Min::In::Stage stage;
+        Frame got[3];
+        size_t n = 0;
+        auto collect = [&](Frame &&f) { got[n++] = std::move(f); };
+        stage(Buffer<uint8_t>{stream.buf, split}, collect);
+        stage(Buffer<uint8_t>{stream.buf + split, stream.len - split}, collect);
+        REQUIRE(n == 2);
+        CHECK(got[0].id == 1);
+        CHECK(got[0].b.len == a.b.len);
+        CHECK(memcmp(got[0].b.buf, a.b.buf, a.b.len) == 0);
+        CHECK(got[1].id == 2);
+        CHECK(got[1].b.len == b.b.len);
+        CHECK(memcmp(got[1].b.buf, b.b.buf, b.b.len) == 0);
+    }
+}
 TEST_CASE("tool-libs: frame: struct roundtrip") {
     struct __attribute__((packed)) TestStruct {
         double pi=3.14;
@@ -154,3 +292,158 @@ TEST_CASE("tool-libs: frame: bool double bug") {
     CHECK(snd.b == b);
     CHECK(snd.d - d == doctest::Approx(0));
 }
+
+/** Buffer link dropping every `every`-th Buffer */
+struct Lossy : Sink<Buffer<uint8_t>> {
+    Queue<Buffer<uint8_t>> q{64};
+    size_t every, n{};
+    Lossy(size_t every) : every(every) { }
+    bool full() override { return q.full(); }
+    void push(Buffer<uint8_t> &&b) override {
+        if (every && ++n % every == 0) return;
+        q.push(std::move(b));
+    }
+};
+TEST_CASE("tool-libs: min: reliable transport") {
+    for (size_t every : {0, 3, 7}) {
+        Lossy ab{every}, ba{every};
+        Min a{.in=ba.q, .out=ab}, b{.in=ab.q, .out=ba};
+        Min::Transport ta{a, 4, 5}, tb{b, 4, 5};
+        uint32_t received = 0;
+        bool inorder = true;
+        struct Check {
+            uint32_t &received;
+            bool &inorder;
+            void handle(Frame &f) {
+                inorder &= f.unpack<uint32_t>() == received;
+                received++;
+            }
+        } check{received, inorder};
+        b.reg.setHandler(5, check, &Check::handle);
+        uint32_t next = 0;
+        for (uint32_t t = 0; t < 2000 && received < 100; ++t) {
+            while (next < 100 && !ta.full()) {
+                Frame f{5};
+                f.pack<uint32_t>(next++);
+                ta.push(std::move(f));
+            }
+            ta.poll(t, 1);
+            tb.poll(t, 1);
+            a.poll(t, 1);
+            b.poll(t, 1);
+        }
+        CHECK(received == 100);
+        CHECK(inorder);
+        CHECK((ta.resent > 0) == (every > 0));
+    }
+}
+TEST_CASE("tool-libs: min: transport frames that cannot be queued are not acked") {
+    Queue<Buffer<uint8_t>> frames{32}, wire{4}, back{32};
+    Min::Out enc{frames};
+    for (uint8_t i = 0; i < 30; ++i) {
+        Frame f{Min::TRANSPORT | 5};
+        f.seq = i;
+        f.pack<uint8_t>(i);
+        enc.push(f);
+    }
+    Buffer<uint8_t> all = 30 * 16;
+    while (!frames.empty()) {
+        for (auto c: frames.pop()) all.append(c);
+    }
+    Min b{.in=wire, .out=back};
+    Min::Transport tb{b, 8, 5};
+    uint8_t received = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        // all Frames arrive at once, more than the In queue holds
+        wire.push(all);
+        tb.poll(pass, 1);
+        while (!b.in.empty()) {
+            Frame f = b.in.pop();
+            CHECK(f.unpack<uint8_t>() == received);
+            received++;
+        }
+    }
+    CHECK(received == 30);
+}
+TEST_CASE("tool-libs: min: transport frames without transport are dropped") {
+    Queue<Buffer<uint8_t>> q{4};
+    Min::Out out{q};
+    Frame f{Min::TRANSPORT | 3};
+    f.pack<uint8_t>(1);
+    out.push(f);
+    Frame g{3};
+    out.push(g);
+    Min::In in{q};
+    REQUIRE_FALSE(in.empty());
+    CHECK(in.pop().id == 3);
+    CHECK(in.empty());
+}
+TEST_CASE("tool-libs: min: framing") {
+    Frame f[4]{1, 2, 3, 4};
+    f[1].pack<uint32_t>(0).pack<uint8_t>(0xaa).pack<uint8_t>(0);
+    f[2].b = Buffer<uint8_t>(255);
+    for (int i = 0; i < 255; ++i) f[2].b.append(i % 255 + 1);
+    f[3].id |= Min::TRANSPORT;
+    f[3].seq = 7;
+    f[3].pack(3.14);
+    auto check = [&](Frame *got, size_t n) {
+        REQUIRE(n == 4);
+        for (size_t i = 0; i < 4; ++i) {
+            CHECK(got[i].id == f[i].id);
+            REQUIRE(got[i].b.len == f[i].b.len);
+            for (size_t j = 0; j < f[i].b.len; ++j) {
+                CHECK(got[i].b.buf[j] == f[i].b.buf[j]);
+            }
+        }
+        CHECK(got[3].seq == 7);
+    };
+    SUBCASE("datagram") {
+        Queue<Buffer<uint8_t>> wire{4};
+        Min::Out out{wire, 1024};
+        out.framing(Min::DATAGRAM);
+        for (auto &fr : f) out.push(fr);
+        out.flush();
+        REQUIRE(wire.size() == 1);
+        auto dgram = wire.pop();
+        // no header bytes, stuffing or checksum
+        CHECK(dgram.len == 2 + (2 + 6) + (2 + 255) + (3 + 8));
+        Frame got[4];
+        size_t n = 0;
+        Min::In::Stage in{Min::DATAGRAM};
+        in(std::move(dgram), [&](Frame &&fr) { got[n++] = std::move(fr); });
+        check(got, n);
+    }
+    SUBCASE("cobs") {
+        Queue<Buffer<uint8_t>> wire{4};
+        Min::Out out{wire, 1024};
+        out.framing(Min::COBS);
+        for (auto &fr : f) out.push(fr);
+        out.flush();
+        REQUIRE(wire.size() == 1);
+        auto stream = wire.pop();
+        size_t zeros = 0;
+        for (auto c : stream) zeros += c == 0;
+        CHECK(zeros == 4);
+        // split the stream at every position
+        for (size_t at = 0; at <= stream.len; ++at) {
+            Frame got[4];
+            size_t n = 0;
+            Min::In::Stage in{Min::COBS};
+            auto put = [&](Frame &&fr) { if (n < 4) got[n++] = std::move(fr); };
+            Buffer<uint8_t> a = at ? at : 1, b = stream.len - at ? stream.len - at : 1;
+            memcpy(a.buf, stream.buf, at);
+            a.len = at;
+            memcpy(b.buf, stream.buf + at, stream.len - at);
+            b.len = stream.len - at;
+            in(std::move(a), put);
+            in(std::move(b), put);
+            check(got, n);
+        }
+        // corrupted Frame is dropped, the following one received
+        stream.buf[3] ^= 0x10;
+        Min::In::Stage in{Min::COBS};
+        size_t n = 0;
+        in(std::move(stream), [&](Frame &&) { n++; });
+        CHECK(n == 3);
+    }
+}
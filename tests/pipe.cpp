@@ -0,0 +1,52 @@
+#include <doctest/doctest.h>
+#include <core/pipe.h>
+#include <comm/min.h>
+#include <comm/line.h>
+#include <comm/bufferutils.h>
+
+TEST_CASE("tool-libs: pipe: source to callable") {
+    Queue<Buffer<uint8_t>> q{3};
+    q.push(Buffer<uint8_t>{(const uint8_t *)"hello\nwor", 9});
+    q.push(Buffer<uint8_t>{(const uint8_t *)"ld\r\n\nbye\n", 9});
+    const char *want[] = {"hello", "world", "bye"};
+    int i = 0;
+    auto lines = pipe(q, LineFilter::Stage{}, [&](Slice<uint8_t> &&l) {
+        CHECK(l.len == strlen(want[i]));
+        CHECK(memcmp(l.begin(), want[i], l.len) == 0);
+        ++i;
+    });
+    lines.poll();
+    CHECK(i == 3);
+    CHECK(q.empty());
+}
+TEST_CASE("tool-libs: pipe: sink to sink") {
+    Queue<Buffer<uint8_t>> viaMin{4}, direct{4};
+    auto out = pipe<Frame>(Min::Out::Stage{}, Hexify::Stage{}, viaMin);
+    Hexify hex{direct};
+    Min::Out min{hex};
+
+    Frame f{7};
+    f.pack(3.14);
+    Sink<Frame> &s = out;
+    s.push(f);
+    min.push(f);
+    CHECK(viaMin.size() == 1);
+    CHECK(direct.size() == 1);
+    auto a = viaMin.pop(), b = direct.pop();
+    CHECK(a.len == b.len);
+    CHECK(memcmp(a.buf, b.buf, a.len) == 0);
+}
+TEST_CASE("tool-libs: pipe: min roundtrip") {
+    int got = 0;
+    auto loop = pipe<Frame>(Min::Out::Stage{}, Min::In::Stage{}, [&](Frame &&f) {
+        CHECK(f.id == got + 1);
+        CHECK(f.unpack<uint32_t>() == 0xaaaaaaaa);
+        ++got;
+    });
+    for (uint8_t id = 1; id < 4; ++id) {
+        Frame f{id};
+        f.pack<uint32_t>(0xaaaaaaaa);
+        loop.push(std::move(f));
+    }
+    CHECK(got == 3);
+}
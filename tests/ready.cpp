@@ -0,0 +1,92 @@
+#include <doctest/doctest.h>
+#include <core/kern.h>
+#include <comm/min.h>
+#include <sys/ready.h>
+#include <unistd.h>
+// minimal Kernel idle implementation
+void Kernel::idle() {
+    tick(1);
+};
+Kernel k;
+
+int handled = 0;
+void handle(Frame &f) {
+    CHECK(f.unpack<uint32_t>() == 0xaaaaaaaa);
+    handled++;
+}
+
+TEST_CASE("tool-libs: ready: signal raised on data") {
+    Queue<Buffer<uint8_t>> q{3};
+    Signal s;
+    Source<Buffer<uint8_t>> &src = q;
+    src.notify(s);
+    CHECK(!s.pending);
+    q.push(Buffer<uint8_t>{1});
+    CHECK(s.pending);
+}
+TEST_CASE("tool-libs: ready: dispatch frames on arrival") {
+    Queue<Buffer<uint8_t>> link{3};
+    Min min{.in=link, .out=link};
+    min.reg.setHandler(3, handle);
+    k.onReady(min.in).call(min, &Min::poll);
+
+    k.dispatchReady();
+    CHECK(handled == 0);
+    Frame f{3};
+    f.pack<uint32_t>(0xaaaaaaaa);
+    min.out.push(f);
+    min.out.push(f);
+    k.dispatchReady();
+    CHECK(handled == 2);
+    k.dispatchReady();
+    CHECK(handled == 2);
+}
+
+/** Source backed by a pipe, registered with Ready like TTY / UDP */
+struct Pipe : Queue<int> {
+    int fd[2];
+    Pipe() : Queue(1) { CHECK(pipe(fd) == 0); }
+    ~Pipe() {
+        Ready::remove(fd[0]);
+        close(fd[0]);
+        close(fd[1]);
+    }
+    void notify(Signal &s) override {
+        Queue::notify(s);
+        Ready::add(fd[0], s);
+    }
+};
+TEST_CASE("tool-libs: ready: fds are removed again") {
+    using namespace std::chrono;
+    auto soon = [] { return steady_clock::now() + milliseconds(10); };
+    SUBCASE("by their owner") {
+        for (size_t i = 0; i < 2 * Ready::MAX; ++i) {
+            Pipe p;
+            Signal s;
+            p.notify(s);
+            CHECK(Ready::fds.len == 1);
+        }
+        CHECK(Ready::fds.len == 0);
+    }
+    SUBCASE("with their Signal") {
+        Pipe p;
+        {
+            Signal s;
+            p.notify(s);
+            CHECK(write(p.fd[1], "x", 1) == 1);
+            CHECK(Ready::wait(soon()));
+            CHECK(s.pending);
+        }
+        CHECK(Ready::fds.len == 0);
+        CHECK_FALSE(Ready::wait(soon()));
+    }
+    SUBCASE("on Kernel teardown") {
+        Pipe p;
+        {
+            Kernel local;
+            local.onReady<int>(p).call([](uint32_t) {});
+            CHECK(Ready::fds.len == 1);
+        }
+        CHECK(Ready::fds.len == 0);
+    }
+}
@@ -0,0 +1,40 @@
+#include <doctest/doctest.h>
+#include <comm/schema.h>
+
+struct State {
+    double x, v;
+    uint32_t count;
+    bool on;
+    int16_t raw[3];
+    uint8_t unsent;
+    SCHEMA(State, x, v, count, on, raw);
+};
+
+TEST_CASE("tool-libs: schema: layout matches field wise packing") {
+    static_assert(Schema::size<State>() == 8 + 8 + 4 + 1 + 6);
+    State s{1.5, -2.25, 42, true, {1, -2, 3}, 7};
+    Frame a{10}, b{10};
+    Schema::pack(a, s);
+    b.pack(s.x).pack(s.v).pack(s.count).pack(s.on);
+    for (auto r : s.raw) b.pack(r);
+    REQUIRE(a.b.len == b.b.len);
+    CHECK(memcmp(a.b.buf, b.b.buf, a.b.len) == 0);
+
+    State r{};
+    CHECK(Schema::unpack(a, r));
+    CHECK(r.x == 1.5);
+    CHECK(r.v == -2.25);
+    CHECK(r.count == 42);
+    CHECK(r.on);
+    CHECK(r.raw[1] == -2);
+    CHECK(r.unsent == 0);
+    // nothing left
+    CHECK_FALSE(Schema::unpack(a, r));
+}
+
+TEST_CASE("tool-libs: schema: descriptor") {
+    Frame d = Schema::describe<State>(61, 10);
+    const char expect[] = "\x0aState\0<ddI?3h\0x,v,count,on,raw";
+    REQUIRE(d.b.len == sizeof(expect));
+    CHECK(memcmp(d.b.buf, expect, sizeof(expect)) == 0);
+}
@@ -0,0 +1,95 @@
+#include <doctest/doctest.h>
+#include <comm/series.h>
+#include <utils/queue.h>
+
+struct Frames : Sink<Frame> {
+    Queue<Frame> q{16};
+    bool full() override { return q.full(); }
+    using Sink<Frame>::push;
+    void push(Frame &&f) override { q.push(std::move(f)); }
+};
+
+static Frame chunk(uint32_t offset, uint32_t total) {
+    Frame f{12};
+    f.pack(offset).pack(total);
+    for (uint32_t i = offset; i < total && i < offset + 10; ++i) {
+        f.pack<double>(i);
+    }
+    return f;
+}
+
+TEST_CASE("tool-libs: series stream") {
+    using S = SeriesStream<double>;
+    CHECK(S::LEN == 10);
+    Buffer<double> dst = 35;
+    S s{dst};
+    SUBCASE("in order") {
+        for (uint32_t o = 0; o < 35; o += 10) {
+            Frame f = chunk(o, 35);
+            CHECK(s.unpack(f) == (o == 30 ? 5 : 10));
+            CHECK(s.available() == (o == 30 ? 35 : o + 10));
+        }
+        CHECK(s.done());
+        CHECK(s.received() == 35);
+        for (size_t i = 0; i < 35; ++i) CHECK(s[i] == i);
+    }
+    SUBCASE("lost and reordered") {
+        Frame a = chunk(0, 35), b = chunk(20, 35), c = chunk(30, 35);
+        s.unpack(c);
+        CHECK(s.available() == 0);
+        s.unpack(a);
+        s.unpack(b);
+        Frame dup = chunk(20, 35);
+        CHECK(s.unpack(dup) == 0);
+        CHECK(s.available() == 10);
+        CHECK(s.received() == 25);
+        CHECK(s.gaps());
+        Frames req;
+        s.requestMissing(req, 13);
+        REQUIRE(req.q.size() == 1);
+        Frame r = req.q.pop();
+        CHECK(r.id == 13);
+        CHECK(r.b.len == 8);
+        CHECK(r.unpack<uint32_t>() == 10);
+        CHECK(r.unpack<uint32_t>() == 10);
+        Frame m = chunk(10, 35);
+        s.unpack(m);
+        CHECK(s.done());
+        CHECK_FALSE(s.gaps());
+        for (size_t i = 0; i < 35; ++i) CHECK(s[i] == i);
+    }
+    SUBCASE("new series") {
+        for (uint32_t o = 0; o < 35; o += 10) {
+            Frame f = chunk(o, 35);
+            s.unpack(f);
+        }
+        Frame f = chunk(0, 35);
+        CHECK(s.unpack(f) == 10);
+        CHECK(s.available() == 10);
+    }
+}
+
+TEST_CASE("tool-libs: series stream: ring") {
+    Buffer<double> dst = 20;
+    SeriesStream<double> s{dst};
+    Frame a = chunk(0, 55), b = chunk(10, 55), c = chunk(20, 55);
+    s.unpack(a);
+    s.unpack(b);
+    // no room yet
+    CHECK(s.unpack(c) == 0);
+    CHECK(s.available() == 20);
+    CHECK(s[15] == 15);
+    s.release(10);
+    Frame again = chunk(20, 55);
+    CHECK(s.unpack(again) == 10);
+    CHECK(s.available() == 30);
+    for (size_t i = 10; i < 30; ++i) CHECK(s[i] == i);
+    s.release(30);
+    for (uint32_t o = 30; o < 55; o += 10) {
+        if (o == 50) s.release(40);
+        Frame f = chunk(o, 55);
+        s.unpack(f);
+    }
+    CHECK(s.done());
+    for (size_t i = 40; i < 55; ++i) CHECK(s[i] == i);
+}
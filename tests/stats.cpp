@@ -0,0 +1,66 @@
+#ifndef TOOL_LIBS_STATS
+#define TOOL_LIBS_STATS
+#endif
+#include <doctest/doctest.h>
+#include <core/stats.h>
+#include <comm/stats.h>
+
+struct Collect : Sink<Buffer<uint8_t>> {
+    size_t lines{};
+    bool full() override { return false; }
+    void push(Buffer<uint8_t> &&) override { lines++; }
+};
+
+TEST_CASE("tool-libs: stats: heap") {
+    auto before = Stats::heap;
+    {
+        Buffer<uint32_t> b = 10;
+        CHECK(Stats::heap.allocs == before.allocs + 1);
+        CHECK(Stats::heap.live == before.live + 40);
+        CHECK(Stats::type<uint32_t>().heap.live >= 40);
+        Buffer<uint32_t> c = b;
+        CHECK(Stats::heap.live == before.live + 80);
+        Buffer<uint32_t> d = std::move(c);
+        CHECK(Stats::heap.live == before.live + 80);
+    }
+    CHECK(Stats::heap.live == before.live);
+    CHECK(Stats::heap.peak >= before.live + 80);
+    CHECK(Stats::heap.frees == before.frees + 2);
+}
+TEST_CASE("tool-libs: stats: queue") {
+    Queue<int> q{3};
+    q.stats.name = "test";
+    q.push(1);
+    q.push(2);
+    q.pop();
+    CHECK(q.stats.hwm == 2);
+    q.push(3);
+    q.push(4);
+    Sink<int> &s = q;
+    s.trypush(5);
+    s.trypush(6);
+    CHECK(q.stats.hwm == 3);
+    CHECK(q.stats.dropped == 2);
+    CHECK(Stats::Queue::list == &q.stats);
+    SUBCASE("frame report") {
+        Queue<Frame> frames{5};
+        Stats::report(frames, 42);
+        Frame f = frames.pop();
+        CHECK(f.id == 42);
+        CHECK(f.unpack<uint8_t>() == 0);
+        // frames queue itself is listed first
+        frames.pop();
+        f = frames.pop();
+        CHECK(f.unpack<uint8_t>() == 1);
+        CHECK(f.unpack<uint32_t>() == 1);
+        CHECK(f.unpack<uint32_t>() == 3);
+        CHECK(f.unpack<uint32_t>() == 3);
+        CHECK(f.unpack<uint32_t>() == 2);
+    }
+    SUBCASE("log report") {
+        Collect c;
+        Logger log{c};
+        Stats::report(log);
+        CHECK(c.lines > 2);
+    }
+}
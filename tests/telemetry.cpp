@@ -0,0 +1,100 @@
+#include <doctest/doctest.h>
+#include <core/telemetry.h>
+// minimal Kernel idle implementation
+void Kernel::idle() {
+    tick(1);
+};
+Kernel k;
+
+TEST_CASE("tool-libs: telemetry: list and select") {
+    Queue<Frame> out{64};
+    FrameRegistry reg;
+    Telemetry tm{out, 20, 64};
+    double x = 1.5;
+    uint32_t count = 7;
+    float big[60]{};
+    CHECK(tm.channel("x", x) == 0);
+    CHECK(tm.channel("count", count, 5) == 1);
+    for (int i = 0; i < 60; ++i) tm.channel("big", big[i], 2);
+    tm.registerWith(reg, 21);
+
+    Frame list{21};
+    list.pack<uint8_t>(Telemetry::LIST);
+    reg.handle(std::move(list));
+    REQUIRE(out.size() == 62);
+    Frame c = out.pop();
+    CHECK(c.id == 21);
+    CHECK(c.unpack<uint8_t>() == Telemetry::LIST);
+    CHECK(c.unpack<uint8_t>() == 0);
+    CHECK(c.unpack<char>() == 'd');
+    CHECK(c.unpack<uint16_t>() == 1);
+    CHECK(c.unpack<char>() == 'x');
+    while (!out.empty()) out.pop();
+
+    // nothing selected, nothing sent
+    tm.tick(0, 1);
+    CHECK(out.empty());
+
+    Frame sel{21};
+    sel.pack<uint8_t>(Telemetry::SELECT).pack<uint8_t>(2)
+        .pack<uint8_t>(0).pack<uint16_t>(2)
+        .pack<uint8_t>(1).pack<uint16_t>(1);
+    reg.handle(std::move(sel));
+    size_t xs = 0, counts = 0;
+    for (uint32_t t = 1; t <= 10; ++t) {
+        tm.tick(t, 1);
+        while (!out.empty()) {
+            Frame d = out.pop();
+            CHECK(d.unpack<uint32_t>() == t);
+            size_t end = d.b.len;
+            for (size_t pos = 4; pos < end;) {
+                uint8_t ix = d.unpack<uint8_t>();
+                if (ix == 0) { CHECK(d.unpack<double>() == 1.5); xs++; pos += 9; }
+                else { CHECK(d.unpack<uint32_t>() == 7); counts++; pos += 5; }
+            }
+        }
+    }
+    CHECK(xs == 5);
+    CHECK(counts == 2);
+
+    SUBCASE("truncated select is dropped") {
+        Frame cut{21};
+        cut.pack<uint8_t>(Telemetry::SELECT).pack<uint8_t>(3)
+            .pack<uint8_t>(0).pack<uint16_t>(1);
+        reg.handle(std::move(cut));
+        Frame empty{21};
+        empty.pack<uint8_t>(Telemetry::SELECT);
+        reg.handle(std::move(empty));
+        // selection from before unchanged
+        tm.tick(11, 1);
+        tm.tick(12, 1);
+        REQUIRE(out.size() == 1);
+        Frame d = out.pop();
+        CHECK(d.unpack<uint32_t>() == 12);
+        CHECK(d.unpack<uint8_t>() == 0);
+    }
+    SUBCASE("long names are cut to fit a frame") {
+        Telemetry named{out, 22, 1};
+        static char name[300];
+        memset(name, 'n', sizeof name - 1);
+        named.channel(name, x);
+        named.registerWith(reg, 22);
+        Frame l{22};
+        l.pack<uint8_t>(Telemetry::LIST);
+        reg.handle(std::move(l));
+        REQUIRE(out.size() == 1);
+        CHECK(out.pop().b.len == 254);
+    }
+
+    SUBCASE("channels are packed into as few frames as possible") {
+        Frame all{21};
+        all.b = Buffer<uint8_t>(255);
+        all.pack<uint8_t>(Telemetry::SELECT).pack<uint8_t>(60);
+        for (int i = 0; i < 60; ++i) all.pack<uint8_t>(2 + i).pack<uint16_t>(1);
+        reg.handle(std::move(all));
+        tm.tick(11, 1);
+        tm.tick(12, 1);
+        // 60 * 5 bytes + time stamps
+        CHECK(out.size() == 2);
+    }
+}
@@ -7,6 +7,9 @@
 #include <cstdint>
 #include <cassert>
 #include <initializer_list>
+#ifdef TOOL_LIBS_STATS
+#include "stats.h"
+#endif
 
 /**
  * dynamically allocated, but fixed-size buffer template
@@ -58,33 +61,50 @@ struct Buffer {
     T* end() { return &buf[len]; }
     T* end() const { return &buf[len]; }
 
+    /** allocate storage for `n` items. instrumented with TOOL_LIBS_STATS */
+    static T *mk(size_t n) {
+#ifdef TOOL_LIBS_STATS
+        Stats::alloc<T>(n);
+#endif
+        return new T[n];
+    }
+    /** release storage of `n` items. instrumented with TOOL_LIBS_STATS */
+    static void rm(T *b, size_t n) {
+#ifdef TOOL_LIBS_STATS
+        if (b) Stats::free<T>(n);
+#else
+        (void)n;
+#endif
+        delete[] b;
+    }
+
     /* Rule of Five */
     /** destructor */
     ~Buffer() {
-        delete[] buf; buf = nullptr; len = 0; size = 0;
+        rm(buf, size); buf = nullptr; len = 0; size = 0;
     }
     /** copy from naked array with known length */
     Buffer(const T *src, size_t len, size_t sz=0) : buf{}, len(0), size(sz) {
         if (sz == 0) size = len;
-        buf = new T[size];
+        buf = mk(size);
         for (size_t i = 0; i < len; ++i) append(src[i]);
     }
     /** initializer list constructor */
-    Buffer(std::initializer_list<T> list) : buf{new T[list.size()]}, len(0), size(list.size()) {
+    Buffer(std::initializer_list<T> list) : buf{mk(list.size())}, len(0), size(list.size()) {
         append(list);
     }
     /** constructor with fixed size */
-    Buffer(size_t sz=0) : buf{new T[sz]}, len(0), size(sz) { }
+    Buffer(size_t sz=0) : buf{mk(sz)}, len(0), size(sz) { }
     /** copy constructor */
-    Buffer(const Buffer &b) : buf{new T[b.size]}, len(0), size(b.size) {
+    Buffer(const Buffer &b) : buf{mk(b.size)}, len(0), size(b.size) {
         for (auto el : b) append(el);
     }
     /** copy assignment operator */
     Buffer& operator=(const Buffer &b) {
         if (this == &b) return *this; // copy to self
         if (!size || size != b.size) { // necessary to realloc
-            delete[] buf;
-            buf = new T[b.size];
+            rm(buf, size);
+            buf = mk(b.size);
             size = b.size;
         }
         assert(buf != nullptr);
@@ -102,7 +122,7 @@ struct Buffer {
     /** move assignment operator */
     Buffer& operator=(Buffer &&b) noexcept {
         if (this == &b) return *this; // move to self
-        delete[] buf;
+        rm(buf, size);
         buf = b.buf;
         len = b.len;
         size = b.size;
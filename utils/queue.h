@@ -32,6 +32,11 @@ class Queue : public Sink<T>, public Source<T> {
     } head, tail;
 
 public:
+#ifdef TOOL_LIBS_STATS
+    /** fill level counters, see Stats::Queue */
+    Stats::Queue stats{q.size};
+    void dropped() override { stats.dropped++; }
+#endif
     /** create Queue directly from filled Buffer */
     Queue(const Buffer<T> &buf) : q(buf), head{q.size}, tail{q.size} {}
     Queue(Buffer<T> &&buf) : q(std::move(buf)), head{q.size}, tail{q.size} {}
@@ -50,6 +55,23 @@ public:
         assert(q.len < q.size);
         q[tail++] = std::move(val);
         q.len++;
+#ifdef TOOL_LIBS_STATS
+        stats.fill(q.len);
+#endif
+        this->ready();
+    }
+    /** move as many elements into queue as fit */
+    size_t pushBatch(T *items, size_t n) override {
+        if (n > q.size - q.len) n = q.size - q.len;
+        for (size_t i = 0; i < n; ++i) {
+            q[tail++] = std::move(items[i]);
+        }
+        q.len += n;
+#ifdef TOOL_LIBS_STATS
+        stats.fill(q.len);
+#endif
+        if (n) this->ready();
+        return n;
     }
     /** return reference to first element in queue */
     T& front() {
@@ -67,6 +89,15 @@ public:
         q.len--;
         return std::move(q[head++]);
     }
+    /** move up to `max` elements out of queue */
+    size_t popBatch(T *out, size_t max) override {
+        if (max > q.len) max = q.len;
+        for (size_t i = 0; i < max; ++i) {
+            out[i] = std::move(q[head++]);
+        }
+        q.len -= max;
+        return max;
+    }
     /**
      * shift head of queue without touching underlying memory
      */
@@ -79,6 +110,10 @@ public:
     size_t size() {
         return q.len;
     }
+    /** return maximum number of elements in queue */
+    size_t capacity() {
+        return q.size;
+    }
     /** check if queue is empty */
     bool empty() override {
         return q.len == 0;
@@ -0,0 +1,104 @@
+/** @file stats.h
+ *
+ * Copyright (c) 2026 IACE
+ *
+ * optional instrumentation of Buffer allocations and Queue fill levels.
+ * compiled in only if `TOOL_LIBS_STATS` is defined, see the `STATS` cmake
+ * option. Reports are produced by core/stats.h and comm/stats.h
+ */
+#pragma once
+#include <cstddef>
+#include <cstring>
+
+/** namespace wrapping all instrumentation counters */
+namespace Stats {
+/** heap usage counters */
+struct Heap {
+    size_t allocs;  ///< number of allocations
+    size_t frees;   ///< number of frees
+    size_t live;    ///< bytes currently allocated
+    size_t peak;    ///< maximum of bytes allocated at any time
+    void alloc(size_t bytes) {
+        allocs++;
+        live += bytes;
+        if (live > peak) peak = live;
+    }
+    void free(size_t bytes) {
+        frees++;
+        live -= bytes;
+    }
+};
+/** global heap usage through Buffer */
+inline Heap heap{};
+
+/** heap usage per Buffer element type
+ *
+ * all types that ever allocated are kept in a singly linked list
+ */
+struct Type {
+    const char *name;   ///< pretty name of type, see `pretty`
+    Heap heap;
+    Type *next;
+    inline static Type *list{};
+    /** human readable type name of given length */
+    const char *pretty(size_t &len) const {
+        const char *start = strstr(name, "T = ");
+        if (!start) { len = strlen(name); return name; }
+        start += 4;
+        const char *end = strchr(start, ']');
+        len = end ? end - start : strlen(start);
+        return start;
+    }
+};
+/** access counters for Buffers of given element type */
+template<typename T>
+Type& type() {
+    static Type t{__PRETTY_FUNCTION__, {}, nullptr};
+    static bool listed = (t.next = Type::list, Type::list = &t, true);
+    (void)listed;
+    return t;
+}
+/** record allocation of `n` elements of type T */
+template<typename T>
+void alloc(size_t n) {
+    heap.alloc(n * sizeof(T));
+    type<T>().heap.alloc(n * sizeof(T));
+}
+/** record free of `n` elements of type T */
+template<typename T>
+void free(size_t n) {
+    heap.free(n * sizeof(T));
+    type<T>().heap.free(n * sizeof(T));
+}
+
+/** fill level counters of a single Queue
+ *
+ * every living Queue is kept in a doubly linked list
+ */
+struct Queue {
+    const char *name{};     ///< optional name used in reports
+    size_t size{};          ///< capacity of Queue
+    size_t hwm{};           ///< high-water mark of Queue
+    size_t dropped{};       ///< number of elements dropped by `trypush`
+    Queue *prev{}, *next{};
+    inline static Queue *list{};
+    /** update high-water mark with current length */
+    void fill(size_t len) {
+        if (len > hwm) hwm = len;
+    }
+    Queue(size_t size) : size(size), next(list) {
+        if (list) list->prev = this;
+        list = this;
+    }
+    Queue(const Queue &o) : Queue(o.size) { name = o.name; }
+    Queue& operator=(const Queue &o) {
+        size = o.size;
+        return *this;
+    }
+    ~Queue() {
+        if (prev) prev->next = next;
+        else list = next;
+        if (next) next->prev = prev;
+    }
+};
+}